@@ -0,0 +1,182 @@
+#define _DECLARE_TOOLBOX_HERE
+#include <benchmark/benchmark.h>
+#include "../lib/ntools.hpp"
+#include "../src/gtf2bed.hpp"
+#include "../src/gtf2bed.cpp"
+#include "../lib/SyntheticAnnotation.hpp"
+
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <cstdio>
+#include <sstream>
+
+// Throughput benchmarks for the parser, the BED writer and whole conversions.
+// Inputs are synthetic GENCODE-like annotation, generated once per process.
+//
+//   bench_gtf2bed --benchmark_out=results.json --benchmark_out_format=json
+
+//-----------------------//
+//  SYNTHETIC INPUT      //
+//-----------------------//
+
+// About 'bytes' of annotation text in the given format, the same on every run
+static const std::string& synthetic_text(FileFormat format, std::size_t bytes = 8 << 20)
+{
+    static std::map<FileFormat, std::string> cache;
+    std::string& text = cache[format];
+    if (text.empty()) {
+        SyntheticOptions options;
+        options.format = format;
+        options.target_bytes = bytes;
+        std::ostringstream out;
+        SyntheticAnnotation(options).write(out);
+        text = std::move(out).str();
+    }
+    return text;
+}
+
+static std::vector<std::string_view> split_lines(const std::string& text)
+{
+    std::vector<std::string_view> lines;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t nl = text.find('\n', pos);
+        if (text[pos] != '#') lines.emplace_back(text.data() + pos, nl - pos);
+        pos = nl + 1;
+    }
+    return lines;
+}
+
+// Temporary input files, removed when the run ends
+static std::map<Compression, std::string> g_files;
+
+// Synthetic GTF written to a temporary file, plain or compressed
+static const std::string& synthetic_file(Compression compression)
+{
+    std::string& name = g_files[compression];
+    if (name.empty()) {
+        const char* suffix = compression == Compression::GZIP ? ".gtf.gz" : compression == Compression::BZIP2 ? ".gtf.bz2" : ".gtf";
+        name = "bench_gtf2bed_input" + std::string(suffix);
+        const std::string& text = synthetic_text(FileFormat::GTF);
+        boost::iostreams::filtering_ostream out;
+        if (compression == Compression::GZIP) out.push(boost::iostreams::gzip_compressor());
+        if (compression == Compression::BZIP2) out.push(boost::iostreams::bzip2_compressor());
+        out.push(boost::iostreams::file_descriptor_sink(name, std::ios::binary | std::ios::trunc));
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    return name;
+}
+
+// Reports bytes/s (shown as MB/s) and items/s under the given counter name
+static void set_throughput(benchmark::State& state, std::size_t bytes, std::size_t items, const char* rate = "lines/s")
+{
+    state.SetBytesProcessed(static_cast<int64_t>(bytes * state.iterations()));
+    state.counters[rate] = benchmark::Counter(static_cast<double>(items * state.iterations()), benchmark::Counter::kIsRate);
+}
+
+//-----------------------//
+//  MICROBENCHMARKS      //
+//-----------------------//
+
+static void BM_ParseLine(benchmark::State& state, FileFormat format)
+{
+    const std::string& text = synthetic_text(format);
+    std::vector<std::string_view> lines = split_lines(text);
+    GTFParser parser(format);
+    GTFLineView view;
+    for (auto _ : state) {
+        for (std::string_view line : lines) {
+            parser.parse_line(line, view);
+            benchmark::DoNotOptimize(view.attributes.data());
+        }
+    }
+    set_throughput(state, text.size(), lines.size());
+}
+BENCHMARK_CAPTURE(BM_ParseLine, gtf, FileFormat::GTF);
+BENCHMARK_CAPTURE(BM_ParseLine, gff, FileFormat::GFF);
+BENCHMARK_CAPTURE(BM_ParseLine, gff3, FileFormat::GFF3);
+
+static void BM_UrlDecode(benchmark::State& state)
+{
+    const bool escaped = state.range(0) != 0;
+    std::vector<std::string> values;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(escaped ? "putative%20kinase%3B%20isoform%20" + std::to_string(i)
+                                 : "ENSG00000" + std::to_string(100000 + i) + ".12");
+    }
+    std::size_t bytes = 0;
+    for (const std::string& value : values) bytes += value.size();
+
+    std::string decoded;
+    decoded.reserve(1 << 16);
+    for (auto _ : state) {
+        decoded.clear();
+        for (const std::string& value : values) GTFParser::decode_into(decoded, value);
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    set_throughput(state, bytes, values.size(), "values/s");
+}
+BENCHMARK(BM_UrlDecode)->ArgName("escaped")->Arg(0)->Arg(1);
+
+static void BM_FormatBedRows(benchmark::State& state)
+{
+    const std::string& text = synthetic_text(FileFormat::GTF);
+    GTFParser parser(FileFormat::GTF);
+    GTFLineView view;
+    AnnotationStore store;
+    std::unordered_set<std::string, string_hash, std::equal_to<>> keys;
+    std::vector<char> seen;
+    for (std::string_view line : split_lines(text)) {
+        parser.parse_line(line, view);
+        collect_keys(view, seen, keys);
+        store.push_back(view);
+    }
+    std::vector<std::string> sortedKeys(keys.begin(), keys.end());
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    const std::vector<uint32_t> keyIds = intern_keys(sortedKeys);
+
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        BedWriter bed(text.size() * 2);
+        for (const GTFRecord& record : store) write_bed_row(bed, record, keyIds);
+        bytes = bed.size();
+        benchmark::DoNotOptimize(bed.take());
+    }
+    set_throughput(state, bytes, store.size());
+}
+BENCHMARK(BM_FormatBedRows)->Unit(benchmark::kMillisecond);
+
+//-----------------------//
+//  END TO END           //
+//-----------------------//
+
+// Cached conversion (cacheGTFFile + writeToBed) of the synthetic GTF; MB/s are of uncompressed input
+static void BM_ConvertFile(benchmark::State& state, Compression compression)
+{
+    vrb.set_silent();
+    const std::string& input = synthetic_file(compression);
+    const std::string& text = synthetic_text(FileFormat::GTF);
+    std::size_t lines = 0;
+    for (auto _ : state) {
+        GTF2Bed converter;
+        converter.featureTypes = {"all"};
+        converter.outFile = "/dev/null";
+        converter.cacheGTFFile(input, FileFormat::GTF);
+        std::vector<std::string> sortedKeys = converter.sortedAttributeKeys();
+        converter.writeToBed(sortedKeys);
+        lines = converter.linecount;
+    }
+    set_throughput(state, text.size(), lines);
+}
+BENCHMARK_CAPTURE(BM_ConvertFile, plain, Compression::NONE)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ConvertFile, gzip, Compression::GZIP)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ConvertFile, bzip2, Compression::BZIP2)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    for (const auto& [compression, name] : g_files) std::remove(name.c_str());
+    return 0;
+}
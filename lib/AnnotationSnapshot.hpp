@@ -0,0 +1,400 @@
+#ifndef ANNOTATION_SNAPSHOT_HPP
+#define ANNOTATION_SNAPSHOT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <optional>
+#include <fstream>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include "KeyDictionary.hpp"
+#include "GTFIterator.hpp"
+#include "AnnotationStore.hpp"
+#include "MappedFile.hpp"
+
+// -----------------------------
+// .g2b snapshot format: the parsed annotation, laid out so that it can be used
+// straight from a memory mapping. All sections start on 8-byte boundaries.
+//
+//   Header
+//   string offsets   uint64[string_count + 1] into the string data
+//   string data      every distinct string once
+//   dictionaries     uint32 string ids: seqname, source, feature, score, frame
+//   fixed columns    seqname u32, source u16, feature u16, score u32, frame u8,
+//                    start i64, end i64, strand char (one entry per row)
+//   attributes       AttributeEntry[attribute_count], then per attribute its
+//                    value string ids and uint32 codes[rows] (0 = missing)
+// -----------------------------
+namespace g2b {
+
+constexpr char magic[8] = {'G', 'T', 'F', '2', 'B', 'E', 'D', 'S'};
+constexpr uint32_t version = 1;
+constexpr uint32_t byte_order = 0x01020304; // read back differently on a foreign-endian host
+
+enum Column { Seqname, Source, Feature, Score, Frame, Start, End, Strand, ColumnCount };
+enum Dictionary { SeqnameDictionary, SourceDictionary, FeatureDictionary, ScoreDictionary, FrameDictionary, DictionaryCount };
+
+// Identifies the source file a snapshot was built from
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t hash = 0;  // FNV-1a over sampled blocks, see of()
+
+    bool operator==(const SourceStamp& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns && hash == other.hash;
+    }
+
+    // Size, modification time and a hash of 16 blocks of 64 KB spread evenly over
+    // the file (first and last included): cheap even for multi-GB inputs
+    static SourceStamp of(const std::string& filename) {
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0) throw std::runtime_error("Cannot stat file: " + filename);
+        SourceStamp stamp;
+        stamp.size = static_cast<uint64_t>(st.st_size);
+        stamp.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+        constexpr std::size_t block_size = 1 << 16;
+        constexpr int blocks = 16;
+        std::ifstream in(filename, std::ios::in | std::ios::binary);
+        std::vector<char> block(block_size);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < blocks; ++i) {
+            uint64_t offset = stamp.size <= block_size ? 0 : (stamp.size - block_size) * i / (blocks - 1);
+            in.seekg(static_cast<std::streamoff>(offset));
+            in.read(block.data(), static_cast<std::streamsize>(block.size()));
+            std::streamsize n = in.gcount();
+            in.clear();
+            for (std::streamsize j = 0; j < n; ++j) {
+                hash = (hash ^ static_cast<unsigned char>(block[j])) * 0x100000001b3ULL;
+            }
+            if (stamp.size <= block_size) break;
+        }
+        stamp.hash = hash;
+        return stamp;
+    }
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t format;
+    uint32_t attribute_count;
+    SourceStamp source;
+    uint64_t rows;
+    uint64_t string_count;
+    uint64_t string_offsets;
+    uint64_t string_data;
+    uint64_t dictionaries;
+    uint32_t dictionary_sizes[DictionaryCount];
+    uint32_t reserved;
+    uint64_t columns[ColumnCount];
+    uint64_t attributes;
+};
+
+struct AttributeEntry {
+    uint32_t key;          // string id of the key
+    uint32_t value_count;  // entry 0 is the "missing" placeholder
+    uint64_t values;       // uint32 string ids[value_count]
+    uint64_t codes;        // uint32[rows]
+};
+
+// Writes store as a snapshot of source. The file is written next to path and
+// renamed into place, so readers never see a partial snapshot.
+inline void write_snapshot(const AnnotationStore& store, FileFormat format, const SourceStamp& source,
+                           const std::string& path) {
+    // String table: every distinct string once
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    auto intern = [&](std::string_view s) {
+        auto [it, added] = ids.emplace(s, static_cast<uint32_t>(strings.size()));
+        if (added) strings.push_back(s);
+        return it->second;
+    };
+
+    std::vector<uint32_t> dictionaries;
+    Header header{};
+    auto add_dictionary = [&](const std::vector<std::string_view>& values, Dictionary d) {
+        header.dictionary_sizes[d] = static_cast<uint32_t>(values.size());
+        for (std::string_view value : values) dictionaries.push_back(intern(value));
+    };
+    add_dictionary(store.seqname_dictionary().values(), SeqnameDictionary);
+    add_dictionary(store.source_dictionary().values(), SourceDictionary);
+    add_dictionary(store.feature_dictionary().values(), FeatureDictionary);
+    add_dictionary(store.score_dictionary().values(), ScoreDictionary);
+    add_dictionary(store.frame_dictionary().values(), FrameDictionary);
+
+    struct Attribute {
+        AttributeEntry entry;
+        std::vector<uint32_t> values;
+        const AttributeColumn* column;
+    };
+    std::vector<Attribute> attributes;
+    for (uint32_t id : store.key_ids()) {
+        Attribute attribute{};
+        attribute.column = store.column(id);
+        attribute.entry.key = intern(key_dictionary().name(id));
+        for (std::string_view value : attribute.column->values) attribute.values.push_back(intern(value));
+        attribute.entry.value_count = static_cast<uint32_t>(attribute.values.size());
+        attributes.push_back(std::move(attribute));
+    }
+
+    std::vector<uint64_t> offsets;
+    offsets.reserve(strings.size() + 1);
+    uint64_t string_bytes = 0;
+    for (std::string_view s : strings) {
+        offsets.push_back(string_bytes);
+        string_bytes += s.size();
+    }
+    offsets.push_back(string_bytes);
+
+    const std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot write snapshot: " + temporary);
+
+    uint64_t position = 0;
+    auto write = [&](const void* data, std::size_t bytes) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        position += bytes;
+    };
+    // Pads to the next 8-byte boundary and returns the offset the section starts at
+    auto section = [&]() {
+        static const char zeros[8] = {};
+        write(zeros, (8 - position % 8) % 8);
+        return position;
+    };
+    auto write_array = [&](const auto& values) {
+        uint64_t offset = section();
+        write(values.data(), values.size() * sizeof(values[0]));
+        return offset;
+    };
+
+    write(&header, sizeof(header)); // placeholder, rewritten once the offsets are known
+    header.string_count = strings.size();
+    header.string_offsets = write_array(offsets);
+    header.string_data = section();
+    for (std::string_view s : strings) write(s.data(), s.size());
+    header.dictionaries = write_array(dictionaries);
+    header.columns[Seqname] = write_array(store.seqname_codes());
+    header.columns[Source] = write_array(store.source_codes());
+    header.columns[Feature] = write_array(store.feature_codes());
+    header.columns[Score] = write_array(store.score_codes());
+    header.columns[Frame] = write_array(store.frame_codes());
+    header.columns[Start] = write_array(store.starts());
+    header.columns[End] = write_array(store.ends());
+    header.columns[Strand] = write_array(store.strands());
+
+    // Entries first (their offsets are filled in below), then the per-attribute arrays
+    header.attributes = section();
+    position += attributes.size() * sizeof(AttributeEntry);
+    out.seekp(static_cast<std::streamoff>(position));
+    for (Attribute& attribute : attributes) {
+        attribute.entry.values = write_array(attribute.values);
+        attribute.entry.codes = write_array(attribute.column->codes);
+    }
+    out.seekp(static_cast<std::streamoff>(header.attributes));
+    for (const Attribute& attribute : attributes) {
+        out.write(reinterpret_cast<const char*>(&attribute.entry), sizeof(AttributeEntry));
+    }
+
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order;
+    header.format = static_cast<uint32_t>(format);
+    header.attribute_count = static_cast<uint32_t>(attributes.size());
+    header.source = source;
+    header.rows = store.size();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) throw std::runtime_error("Cannot write snapshot: " + temporary);
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) throw std::runtime_error("Cannot write snapshot: " + path);
+}
+
+} // namespace g2b
+
+class AnnotationSnapshot;
+
+// -----------------------------
+// SnapshotRecord: One row of a snapshot, with the interface of GTFRecord
+// -----------------------------
+struct SnapshotRecord {
+    std::string_view seqname;
+    std::string_view source;
+    std::string_view feature;
+    int64_t start = 0;
+    int64_t end = 0;
+    std::string_view score;
+    char strand = '.';
+    std::string_view frame;
+
+    const AnnotationSnapshot* snapshot = nullptr;
+    std::size_t row = 0;
+
+    inline std::optional<std::string_view> find(uint32_t id) const;
+};
+
+// -----------------------------
+// AnnotationSnapshot: Read-only view of a memory-mapped .g2b snapshot
+// Nothing is parsed or copied on open: rows are read straight from the mapping.
+// Open checks every string id and code in one pass, so rows are never read out of bounds.
+// -----------------------------
+class AnnotationSnapshot {
+public:
+    // Throws std::runtime_error if path is not a complete snapshot of this version
+    explicit AnnotationSnapshot(const std::string& path) : mapped_(path) {
+        data_ = mapped_.data();
+        if (data_.size() < sizeof(g2b::Header)) throw std::runtime_error("Not a gtf2bed snapshot: " + path);
+        header_ = reinterpret_cast<const g2b::Header*>(data_.data());
+        if (std::memcmp(header_->magic, g2b::magic, sizeof(g2b::magic)) != 0 || header_->byte_order != g2b::byte_order) {
+            throw std::runtime_error("Not a gtf2bed snapshot: " + path);
+        }
+        if (header_->version != g2b::version) throw std::runtime_error("Unsupported snapshot version: " + path);
+
+        const uint64_t rows = header_->rows;
+        const uint64_t string_count = header_->string_count;
+        if (string_count >= data_.size()) throw std::runtime_error("Truncated or corrupt gtf2bed snapshot");
+        offsets_ = array<uint64_t>(header_->string_offsets, string_count + 1);
+        for (uint64_t i = 0; i < string_count; ++i) {
+            if (offsets_[i] > offsets_[i + 1]) throw std::runtime_error("Truncated or corrupt gtf2bed snapshot");
+        }
+        strings_ = array<char>(header_->string_data, offsets_[string_count]);
+        uint64_t dictionary_entries = 0;
+        for (uint32_t size : header_->dictionary_sizes) dictionary_entries += size;
+        const uint32_t* dictionary = array<uint32_t>(header_->dictionaries, dictionary_entries);
+        check_codes(dictionary, dictionary_entries, string_count);
+        for (int d = 0; d < g2b::DictionaryCount; ++d) {
+            dictionaries_[d] = dictionary;
+            dictionary += header_->dictionary_sizes[d];
+        }
+        seqname_ = array<uint32_t>(header_->columns[g2b::Seqname], rows);
+        source_ = array<uint16_t>(header_->columns[g2b::Source], rows);
+        feature_ = array<uint16_t>(header_->columns[g2b::Feature], rows);
+        score_ = array<uint32_t>(header_->columns[g2b::Score], rows);
+        frame_ = array<uint8_t>(header_->columns[g2b::Frame], rows);
+        check_codes(seqname_, rows, header_->dictionary_sizes[g2b::SeqnameDictionary]);
+        check_codes(source_, rows, header_->dictionary_sizes[g2b::SourceDictionary]);
+        check_codes(feature_, rows, header_->dictionary_sizes[g2b::FeatureDictionary]);
+        check_codes(score_, rows, header_->dictionary_sizes[g2b::ScoreDictionary]);
+        check_codes(frame_, rows, header_->dictionary_sizes[g2b::FrameDictionary]);
+        start_ = array<int64_t>(header_->columns[g2b::Start], rows);
+        end_ = array<int64_t>(header_->columns[g2b::End], rows);
+        strand_ = array<char>(header_->columns[g2b::Strand], rows);
+
+        // Attribute columns, indexed by this process's key ids
+        const g2b::AttributeEntry* entries = array<g2b::AttributeEntry>(header_->attributes, header_->attribute_count);
+        for (uint32_t i = 0; i < header_->attribute_count; ++i) {
+            check_codes(&entries[i].key, 1, string_count);
+            Column column;
+            column.key = key_dictionary().id(string(entries[i].key));
+            column.values = array<uint32_t>(entries[i].values, entries[i].value_count);
+            column.codes = array<uint32_t>(entries[i].codes, rows);
+            check_codes(column.values, entries[i].value_count, string_count);
+            check_codes(column.codes, rows, entries[i].value_count);
+            if (column.key >= by_key_.size()) by_key_.resize(column.key + 1, npos);
+            by_key_[column.key] = static_cast<uint32_t>(columns_.size());
+            columns_.push_back(column);
+        }
+    }
+
+    AnnotationSnapshot(const AnnotationSnapshot&) = delete;
+    AnnotationSnapshot& operator=(const AnnotationSnapshot&) = delete;
+
+    std::size_t size() const { return header_->rows; }
+    FileFormat format() const { return static_cast<FileFormat>(header_->format); }
+    const g2b::SourceStamp& source() const { return header_->source; }
+
+    std::string_view string(uint32_t id) const {
+        return std::string_view(strings_ + offsets_[id], offsets_[id + 1] - offsets_[id]);
+    }
+
+    std::string_view feature(std::size_t row) const { return dictionary(g2b::FeatureDictionary, feature_[row]); }
+
+    SnapshotRecord operator[](std::size_t row) const {
+        SnapshotRecord record;
+        record.seqname = dictionary(g2b::SeqnameDictionary, seqname_[row]);
+        record.source = dictionary(g2b::SourceDictionary, source_[row]);
+        record.feature = dictionary(g2b::FeatureDictionary, feature_[row]);
+        record.start = start_[row];
+        record.end = end_[row];
+        record.score = dictionary(g2b::ScoreDictionary, score_[row]);
+        record.strand = strand_[row];
+        record.frame = dictionary(g2b::FrameDictionary, frame_[row]);
+        record.snapshot = this;
+        record.row = row;
+        return record;
+    }
+
+    // Value of attribute key on row, or nullopt if the row does not have it
+    std::optional<std::string_view> attribute(std::size_t row, uint32_t key) const {
+        if (key >= by_key_.size() || by_key_[key] == npos) return std::nullopt;
+        const Column& column = columns_[by_key_[key]];
+        uint32_t code = column.codes[row];
+        if (code == 0) return std::nullopt;
+        return string(column.values[code]);
+    }
+
+    // Key ids of the attribute columns, and whether a row has a value in column i
+    std::size_t attribute_count() const { return columns_.size(); }
+    uint32_t attribute_key(std::size_t i) const { return columns_[i].key; }
+    bool has_attribute(std::size_t i, std::size_t row) const { return columns_[i].codes[row] != 0; }
+
+private:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct Column {
+        uint32_t key;
+        const uint32_t* values;
+        const uint32_t* codes;
+    };
+
+    MappedFile mapped_;
+    std::string_view data_;
+    const g2b::Header* header_ = nullptr;
+    const uint64_t* offsets_ = nullptr;
+    const char* strings_ = nullptr;
+    std::array<const uint32_t*, g2b::DictionaryCount> dictionaries_{};
+    const uint32_t* seqname_ = nullptr;
+    const uint16_t* source_ = nullptr;
+    const uint16_t* feature_ = nullptr;
+    const uint32_t* score_ = nullptr;
+    const uint8_t* frame_ = nullptr;
+    const int64_t* start_ = nullptr;
+    const int64_t* end_ = nullptr;
+    const char* strand_ = nullptr;
+    std::vector<Column> columns_;
+    std::vector<uint32_t> by_key_;
+
+    std::string_view dictionary(g2b::Dictionary d, uint32_t code) const { return string(dictionaries_[d][code]); }
+
+    // Typed view of count elements at offset, checked against the file size
+    template <typename T>
+    const T* array(uint64_t offset, uint64_t count) const {
+        if (offset % alignof(T) != 0 || offset > data_.size() || count > (data_.size() - offset) / sizeof(T)) {
+            throw std::runtime_error("Truncated or corrupt gtf2bed snapshot");
+        }
+        return reinterpret_cast<const T*>(data_.data() + offset);
+    }
+
+    // Every one of count codes indexes a table of size entries
+    template <typename T>
+    static void check_codes(const T* codes, uint64_t count, uint64_t size) {
+        for (uint64_t i = 0; i < count; ++i) {
+            if (codes[i] >= size) throw std::runtime_error("Truncated or corrupt gtf2bed snapshot");
+        }
+    }
+};
+
+inline std::optional<std::string_view> SnapshotRecord::find(uint32_t id) const {
+    return snapshot->attribute(row, id);
+}
+
+#endif // ANNOTATION_SNAPSHOT_HPP
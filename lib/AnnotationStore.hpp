@@ -0,0 +1,260 @@
+#ifndef ANNOTATION_STORE_HPP
+#define ANNOTATION_STORE_HPP
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+
+#include "Arena.hpp"
+#include "KeyDictionary.hpp"
+#include "GTFIterator.hpp"
+
+// -----------------------------
+// StringDictionary: Dictionary encoding for a low-cardinality column
+// Codes are dense in order of first appearance; values live in the store's arena.
+// -----------------------------
+template <typename Code>
+class StringDictionary {
+public:
+    Code encode(std::string_view value, Arena& arena) {
+        // Consecutive lines mostly repeat the previous value
+        if (last_ < values_.size() && values_[last_] == value) return static_cast<Code>(last_);
+        auto it = codes_.find(value);
+        if (it == codes_.end()) {
+            if (values_.size() > std::numeric_limits<Code>::max()) {
+                throw std::length_error("Too many distinct values for a dictionary-encoded column");
+            }
+            std::string_view stored = arena.copy(value);
+            it = codes_.emplace(stored, static_cast<Code>(values_.size())).first;
+            values_.push_back(stored);
+        }
+        last_ = it->second;
+        return it->second;
+    }
+
+    // Returns the code of value, or size() if it never occurred
+    std::size_t find(std::string_view value) const {
+        auto it = codes_.find(value);
+        return it == codes_.end() ? values_.size() : it->second;
+    }
+
+    std::string_view value(Code code) const { return values_[code]; }
+    const std::vector<std::string_view>& values() const { return values_; }
+    std::size_t size() const { return values_.size(); }
+
+private:
+    std::vector<std::string_view> values_;
+    std::unordered_map<std::string_view, Code> codes_;
+    std::size_t last_ = std::numeric_limits<std::size_t>::max();
+};
+
+// -----------------------------
+// AttributeColumn: Values of one attribute key for every row
+// Code 0 means the row has no such attribute; runs of equal values share a code.
+// -----------------------------
+struct AttributeColumn {
+    std::vector<uint32_t> codes;
+    std::vector<std::string_view> values = {std::string_view()};
+
+    const std::string_view* get(std::size_t row) const {
+        uint32_t code = codes[row];
+        return code ? &values[code] : nullptr;
+    }
+};
+
+class AnnotationStore;
+
+// -----------------------------
+// GTFRecord: One row of the store, materialised on access
+// -----------------------------
+struct GTFRecord {
+    std::string_view seqname;
+    std::string_view source;
+    std::string_view feature;
+    int64_t start = 0;
+    int64_t end = 0;
+    std::string_view score;
+    char strand = '.';
+    std::string_view frame;
+
+    const AnnotationStore* store = nullptr;
+    std::size_t row = 0;
+
+    inline const std::string_view* find(uint32_t id) const;
+};
+
+// -----------------------------
+// AnnotationStore: Columnar (structure-of-arrays) store of cached GTF lines
+// seqname/source/feature/score/frame are dictionary-encoded, coordinates are
+// contiguous int64 arrays and every attribute key has its own value column.
+// -----------------------------
+class AnnotationStore {
+public:
+    void push_back(const GTFLineView& line) {
+        const std::size_t row = start_.size();
+
+        seqname_.push_back(seqnames_.encode(line.seqname, arena_));
+        source_.push_back(sources_.encode(line.source, arena_));
+        feature_.push_back(features_.encode(line.feature, arena_));
+        score_.push_back(scores_.encode(line.score, arena_));
+        frame_.push_back(frames_.encode(line.frame, arena_));
+        start_.push_back(line.start);
+        end_.push_back(line.end);
+        strand_.push_back(line.strand);
+
+        for (const GTFAttribute& attr : line.attributes) {
+            AttributeColumn& column = column_for(attr.id, row);
+            uint32_t code = encode_value(column, attr.value);
+            // A repeated key overwrites this row's value: later duplicates win
+            if (column.codes.size() == row + 1) column.codes.back() = code;
+            else column.codes.push_back(code);
+        }
+        // Keys absent from this line get the "missing" code
+        for (AttributeColumn* column : active_) {
+            if (column->codes.size() == row) column->codes.push_back(0);
+        }
+    }
+
+    void push_back(const GTFLine& line) {
+        GTFLineView view;
+        view.seqname = line.seqname;
+        view.source = line.source;
+        view.feature = line.feature;
+        view.start = line.start;
+        view.end = line.end;
+        view.score = line.score;
+        view.strand = line.strand;
+        view.frame = line.frame;
+        for (const AttributeList::Entry& entry : line.attributes) {
+            view.attributes.push_back({std::string_view(), entry.value, entry.id});
+        }
+        push_back(view);
+    }
+
+    std::size_t size() const { return start_.size(); }
+    bool empty() const { return start_.empty(); }
+
+    GTFRecord operator[](std::size_t row) const {
+        GTFRecord record;
+        record.seqname = seqnames_.value(seqname_[row]);
+        record.source = sources_.value(source_[row]);
+        record.feature = features_.value(feature_[row]);
+        record.start = start_[row];
+        record.end = end_[row];
+        record.score = scores_.value(score_[row]);
+        record.strand = strand_[row];
+        record.frame = frames_.value(frame_[row]);
+        record.store = this;
+        record.row = row;
+        return record;
+    }
+
+    // Value of attribute key on row, or nullptr if the row does not have it
+    const std::string_view* attribute(std::size_t row, uint32_t key) const {
+        return key < columns_.size() && columns_[key] ? columns_[key]->get(row) : nullptr;
+    }
+
+    // Column access for tight loops
+    const std::vector<uint32_t>& seqname_codes() const { return seqname_; }
+    const std::vector<uint16_t>& source_codes() const { return source_; }
+    const std::vector<uint16_t>& feature_codes() const { return feature_; }
+    const std::vector<uint32_t>& score_codes() const { return score_; }
+    const std::vector<uint8_t>& frame_codes() const { return frame_; }
+    const std::vector<int64_t>& starts() const { return start_; }
+    const std::vector<int64_t>& ends() const { return end_; }
+    const std::vector<char>& strands() const { return strand_; }
+    const StringDictionary<uint32_t>& seqname_dictionary() const { return seqnames_; }
+    const StringDictionary<uint16_t>& source_dictionary() const { return sources_; }
+    const StringDictionary<uint16_t>& feature_dictionary() const { return features_; }
+    const StringDictionary<uint32_t>& score_dictionary() const { return scores_; }
+    const StringDictionary<uint8_t>& frame_dictionary() const { return frames_; }
+    const AttributeColumn* column(uint32_t key) const { return key < columns_.size() ? columns_[key].get() : nullptr; }
+
+    // Ids of the attribute keys that occur on at least one row
+    std::vector<uint32_t> key_ids() const {
+        std::vector<uint32_t> ids;
+        for (uint32_t id = 0; id < columns_.size(); ++id) {
+            if (columns_[id]) ids.push_back(id);
+        }
+        return ids;
+    }
+
+    const Arena& arena() const { return arena_; }
+
+    // Row iterator yielding GTFRecord by value
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = GTFRecord;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = GTFRecord;
+
+        const_iterator(const AnnotationStore* store, std::size_t row) : store_(store), row_(row) {}
+        GTFRecord operator*() const { return (*store_)[row_]; }
+        const_iterator& operator++() { ++row_; return *this; }
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.row_ == b.row_; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.row_ != b.row_; }
+
+    private:
+        const AnnotationStore* store_;
+        std::size_t row_;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    Arena arena_;
+
+    // Fixed columns
+    std::vector<uint32_t> seqname_;
+    std::vector<uint16_t> source_;
+    std::vector<uint16_t> feature_;
+    std::vector<uint32_t> score_;
+    std::vector<uint8_t> frame_;
+    std::vector<int64_t> start_;
+    std::vector<int64_t> end_;
+    std::vector<char> strand_;
+
+    StringDictionary<uint32_t> seqnames_;
+    StringDictionary<uint16_t> sources_;
+    StringDictionary<uint16_t> features_;
+    StringDictionary<uint32_t> scores_;
+    StringDictionary<uint8_t> frames_;
+
+    // Attribute columns indexed by interned key id
+    std::vector<std::unique_ptr<AttributeColumn>> columns_;
+    std::vector<AttributeColumn*> active_;
+
+    AttributeColumn& column_for(uint32_t key, std::size_t row) {
+        if (key >= columns_.size()) columns_.resize(key + 1);
+        if (!columns_[key]) {
+            columns_[key] = std::make_unique<AttributeColumn>();
+            columns_[key]->codes.assign(row, 0); // earlier rows lack this key
+            active_.push_back(columns_[key].get());
+        }
+        return *columns_[key];
+    }
+
+    uint32_t encode_value(AttributeColumn& column, std::string_view value) {
+        // Runs of equal values (gene_id across a gene's transcripts and exons) share a code
+        if (column.values.size() > 1 && column.values.back() == value) {
+            return static_cast<uint32_t>(column.values.size() - 1);
+        }
+        column.values.push_back(arena_.copy(value));
+        return static_cast<uint32_t>(column.values.size() - 1);
+    }
+};
+
+inline const std::string_view* GTFRecord::find(uint32_t id) const {
+    return store->attribute(row, id);
+}
+
+#endif // ANNOTATION_STORE_HPP
@@ -0,0 +1,72 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+// -----------------------------
+// Arena: Chunked bump allocator; everything is released at once when it dies
+// -----------------------------
+class Arena {
+public:
+    static constexpr std::size_t default_chunk_size = 1 << 20; // 1 MB
+
+    explicit Arena(std::size_t chunk_size = default_chunk_size) : chunk_size_(chunk_size) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    // Returns n bytes aligned to align
+    void* allocate(std::size_t n, std::size_t align = alignof(std::max_align_t)) {
+        std::size_t offset = (used_ + align - 1) & ~(align - 1);
+        if (chunks_.empty() || offset + n > capacity_) {
+            // Oversized requests get a chunk of their own
+            capacity_ = std::max(chunk_size_, n + align);
+            chunks_.emplace_back(new char[capacity_]);
+            bytes_reserved_ += capacity_;
+            used_ = 0;
+            offset = (reinterpret_cast<std::uintptr_t>(chunks_.back().get()) % align)
+                   ? align - reinterpret_cast<std::uintptr_t>(chunks_.back().get()) % align : 0;
+        }
+        void* p = chunks_.back().get() + offset;
+        used_ = offset + n;
+        return p;
+    }
+
+    // Copies s into the arena and returns a view of the copy
+    std::string_view copy(std::string_view s) {
+        if (s.empty()) return std::string_view();
+        char* p = static_cast<char*>(allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return std::string_view(p, s.size());
+    }
+
+    // Uninitialised array of n trivially copyable objects
+    template <typename T>
+    T* allocate_array(std::size_t n) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "Arena only holds trivially copyable objects");
+        if (n == 0) return nullptr;
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    std::size_t chunks() const { return chunks_.size(); }
+    std::size_t bytes_reserved() const { return bytes_reserved_; }
+
+private:
+    std::size_t chunk_size_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+    std::size_t bytes_reserved_ = 0;
+};
+
+#endif // ARENA_HPP
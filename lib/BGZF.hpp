@@ -0,0 +1,479 @@
+#ifndef BGZF_HPP
+#define BGZF_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <deque>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+//BOOST INCLUDES
+#include <boost/iostreams/categories.hpp>
+
+#include "ThreadPool.hpp"
+
+// -----------------------------
+// Compression: How an input file is encoded, detected from its magic bytes
+// -----------------------------
+enum class Compression {
+    NONE,
+    GZIP,
+    BGZF,
+    BZIP2
+};
+
+namespace bgzf {
+
+constexpr std::size_t max_block_size = 65536;       // compressed or uncompressed block limit
+constexpr std::size_t header_size = 18;             // gzip header with the 6-byte BC extra field
+constexpr std::size_t footer_size = 8;              // CRC32 + ISIZE
+constexpr std::size_t block_data_size = 0xff00;     // uncompressed bytes per block, as bgzip cuts them
+
+// Empty block that terminates every BGZF file
+constexpr unsigned char eof_block[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+inline uint16_t read_u16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+inline uint32_t read_u32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+         | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Returns the total block size (BSIZE + 1) if header is a BGZF member header, 0 otherwise
+inline std::size_t block_size(const unsigned char* header, std::size_t length) {
+    if (length < 12 || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || !(header[3] & 4)) return 0;
+    std::size_t xlen = read_u16(header + 10);
+    if (length < 12 + xlen) return 0;
+    // Walk the extra subfields looking for BC (the BGZF block size)
+    for (std::size_t p = 12; p + 4 <= 12 + xlen; ) {
+        std::size_t slen = read_u16(header + p + 2);
+        if (header[p] == 'B' && header[p + 1] == 'C' && slen == 2 && p + 6 <= 12 + xlen) {
+            return static_cast<std::size_t>(read_u16(header + p + 4)) + 1;
+        }
+        p += 4 + slen;
+    }
+    return 0;
+}
+
+// Inflates one complete BGZF block and checks its CRC32
+inline std::string inflate_block(const std::vector<unsigned char>& block) {
+    std::size_t xlen = read_u16(block.data() + 10);
+    std::size_t cdata = 12 + xlen;
+    if (block.size() < cdata + 8) throw std::runtime_error("Truncated BGZF block");
+
+    uint32_t crc = read_u32(block.data() + block.size() - 8);
+    uint32_t isize = read_u32(block.data() + block.size() - 4);
+    std::string out(isize, '\0');
+    if (isize == 0) return out;
+
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK) throw std::runtime_error("Cannot initialise zlib inflate");
+    zs.next_in = const_cast<Bytef*>(block.data() + cdata);
+    zs.avail_in = static_cast<uInt>(block.size() - 8 - cdata);
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = isize;
+    int ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END || zs.avail_out != 0) throw std::runtime_error("Corrupted BGZF block");
+    if (crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(out.data()), isize) != crc) {
+        throw std::runtime_error("BGZF block failed its CRC32 check");
+    }
+    return out;
+}
+
+inline void write_u16(unsigned char* p, uint16_t v) { p[0] = v & 0xff; p[1] = v >> 8; }
+inline void write_u32(unsigned char* p, uint32_t v) {
+    p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; p[2] = (v >> 16) & 0xff; p[3] = (v >> 24) & 0xff;
+}
+
+// Deflates up to block_data_size bytes into one complete BGZF block
+inline std::string deflate_block(const char* data, std::size_t length, int level) {
+    std::string block(max_block_size, '\0');
+    unsigned char* out = reinterpret_cast<unsigned char*>(block.data());
+
+    // Incompressible data can outgrow the block; retry uncompressed (level 0) in that case
+    for (int attempt_level : {level, 0}) {
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, attempt_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Cannot initialise zlib deflate");
+        }
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = static_cast<uInt>(length);
+        zs.next_out = out + header_size;
+        zs.avail_out = static_cast<uInt>(max_block_size - header_size - footer_size);
+        int ret = deflate(&zs, Z_FINISH);
+        std::size_t cdata = zs.total_out;
+        deflateEnd(&zs);
+        if (ret != Z_STREAM_END) {
+            if (attempt_level == 0) throw std::runtime_error("BGZF block does not fit in 64 KB");
+            continue;
+        }
+
+        std::size_t total = header_size + cdata + footer_size;
+        const unsigned char header[header_size] = {
+            0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+        };
+        std::memcpy(out, header, header_size);
+        write_u16(out + 16, static_cast<uint16_t>(total - 1));
+        write_u32(out + total - 8, crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), static_cast<uInt>(length)));
+        write_u32(out + total - 4, static_cast<uint32_t>(length));
+        block.resize(total);
+        return block;
+    }
+    return block; // unreachable
+}
+
+} // namespace bgzf
+
+// -----------------------------
+// detect_compression: Sniffs gzip/BGZF/bzip2 magic bytes at the start of a file
+// -----------------------------
+inline Compression detect_compression(const std::string& filename) {
+    std::ifstream fd(filename.c_str(), std::ios::in | std::ios::binary);
+    unsigned char header[bgzf::header_size] = {0};
+    fd.read(reinterpret_cast<char*>(header), sizeof(header));
+    std::size_t n = static_cast<std::size_t>(fd.gcount());
+    if (n >= 3 && header[0] == 'B' && header[1] == 'Z' && header[2] == 'h') return Compression::BZIP2;
+    if (n >= 2 && header[0] == 0x1f && header[1] == 0x8b) {
+        return bgzf::block_size(header, n) ? Compression::BGZF : Compression::GZIP;
+    }
+    return Compression::NONE;
+}
+
+// -----------------------------
+// BGZFReader: Inflates BGZF blocks on a thread pool and hands them out in file order
+// -----------------------------
+class BGZFReader {
+public:
+    BGZFReader(const std::string& filename, unsigned int threads)
+        : pool_(threads), window_(static_cast<std::size_t>(std::max(1u, threads)) * 4) {
+        file_.open(filename.c_str(), std::ios::in | std::ios::binary);
+        if (file_.fail()) throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    // Copies up to n decompressed bytes into s; returns -1 at end of data
+    std::streamsize read(char* s, std::streamsize n) {
+        std::streamsize copied = 0;
+        while (copied < n) {
+            if (pos_ == current_.size()) {
+                if (!next_block()) break;
+                continue;
+            }
+            std::size_t take = std::min(static_cast<std::size_t>(n - copied), current_.size() - pos_);
+            std::memcpy(s + copied, current_.data() + pos_, take);
+            pos_ += take;
+            copied += static_cast<std::streamsize>(take);
+        }
+        return copied == 0 ? -1 : copied;
+    }
+
+    // Compressed bytes consumed so far (for progress reporting, from any thread)
+    uint64_t compressed_offset() const { return coffset_.load(std::memory_order_relaxed); }
+
+private:
+    std::ifstream file_;
+    ThreadPool pool_;
+    std::size_t window_;
+    std::deque<std::future<std::string>> pending_;
+    std::string current_;
+    std::size_t pos_ = 0;
+    std::atomic<uint64_t> coffset_{0};
+    bool eof_ = false;
+
+    // Reads the next raw block from disk, false at end of file
+    bool read_raw_block(std::vector<unsigned char>& block) {
+        unsigned char header[bgzf::header_size];
+        file_.read(reinterpret_cast<char*>(header), sizeof(header));
+        std::size_t n = static_cast<std::size_t>(file_.gcount());
+        if (n == 0) return false;
+        std::size_t size = bgzf::block_size(header, n);
+        if (size == 0 || size < n) throw std::runtime_error("Input is not a valid BGZF file");
+        block.resize(size);
+        std::memcpy(block.data(), header, n);
+        file_.read(reinterpret_cast<char*>(block.data() + n), static_cast<std::streamsize>(size - n));
+        if (static_cast<std::size_t>(file_.gcount()) != size - n) throw std::runtime_error("Truncated BGZF block");
+        coffset_.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Keeps the pool busy with up to window_ blocks and takes the oldest one
+    bool next_block() {
+        while (!eof_ && pending_.size() < window_) {
+            auto block = std::make_shared<std::vector<unsigned char>>();
+            if (!read_raw_block(*block)) {
+                eof_ = true;
+                break;
+            }
+            pending_.push_back(pool_.submit([block] { return bgzf::inflate_block(*block); }));
+        }
+        if (pending_.empty()) return false;
+        current_ = pending_.front().get();
+        pending_.pop_front();
+        pos_ = 0;
+        return true;
+    }
+};
+
+// -----------------------------
+// bgzf_source: Boost.Iostreams source device over a shared BGZFReader
+// -----------------------------
+class bgzf_source {
+public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    bgzf_source(const std::string& filename, unsigned int threads)
+        : reader_(std::make_shared<BGZFReader>(filename, threads)) {}
+
+    std::streamsize read(char* s, std::streamsize n) { return reader_->read(s, n); }
+
+    const std::shared_ptr<BGZFReader>& reader() const { return reader_; }
+
+private:
+    std::shared_ptr<BGZFReader> reader_; // devices are copied when pushed onto a chain
+};
+
+// -----------------------------
+// BGZFChunkReader: Reads ranges of a BGZF file given as virtual offsets (block
+// offset << 16 | offset in the inflated block), e.g. the chunks a tabix index
+// lists for a region. Ranges must be sorted and disjoint; a block shared by
+// neighbouring ranges is inflated once.
+// -----------------------------
+class BGZFChunkReader {
+public:
+    using Chunk = std::pair<uint64_t, uint64_t>; // [begin, end) virtual offsets
+
+    BGZFChunkReader(const std::string& filename, std::vector<Chunk> chunks) : chunks_(std::move(chunks)) {
+        file_.open(filename.c_str(), std::ios::in | std::ios::binary);
+        if (file_.fail()) throw std::runtime_error("Cannot open file: " + filename);
+        if (!chunks_.empty()) enter_chunk();
+    }
+
+    // Copies up to n bytes of the ranges into s; returns -1 after the last range
+    std::streamsize read(char* s, std::streamsize n) {
+        std::streamsize copied = 0;
+        while (copied < n && chunk_ < chunks_.size()) {
+            if (pos_ == limit_) {
+                advance();
+                continue;
+            }
+            std::size_t take = std::min(static_cast<std::size_t>(n - copied), limit_ - pos_);
+            std::memcpy(s + copied, current_.data() + pos_, take);
+            pos_ += take;
+            copied += static_cast<std::streamsize>(take);
+        }
+        return copied == 0 ? -1 : copied;
+    }
+
+    // Compressed bytes read so far (for progress reporting, from any thread)
+    uint64_t compressed_offset() const { return read_.load(std::memory_order_relaxed); }
+
+private:
+    std::ifstream file_;
+    std::vector<Chunk> chunks_;
+    std::size_t chunk_ = 0;
+    std::string current_;          // inflated block
+    uint64_t block_offset_ = 0;    // where current_ starts in the file
+    uint64_t next_offset_ = 0;     // where the block after it starts
+    bool loaded_ = false;
+    std::size_t pos_ = 0;
+    std::size_t limit_ = 0;        // end of the current range within current_
+    std::atomic<uint64_t> read_{0};
+
+    // Positions on the start of the current range, reusing the loaded block if it holds it
+    void enter_chunk() {
+        const uint64_t begin = chunks_[chunk_].first;
+        if (!loaded_ || block_offset_ != begin >> 16) {
+            if (!load(begin >> 16)) {
+                chunk_ = chunks_.size();
+                return;
+            }
+        }
+        pos_ = static_cast<std::size_t>(begin & 0xffff);
+        set_limit();
+    }
+
+    // Continues in the next block while the range goes on, else moves to the next range
+    void advance() {
+        if (block_offset_ < chunks_[chunk_].second >> 16) {
+            if (load(next_offset_)) {
+                pos_ = 0;
+                set_limit();
+                return;
+            }
+            chunk_ = chunks_.size(); // the file ends before the range does
+            return;
+        }
+        if (++chunk_ < chunks_.size()) enter_chunk();
+    }
+
+    void set_limit() {
+        const uint64_t end = chunks_[chunk_].second;
+        limit_ = block_offset_ == end >> 16 ? std::min<std::size_t>(end & 0xffff, current_.size()) : current_.size();
+        pos_ = std::min(pos_, limit_);
+    }
+
+    // Reads and inflates the block at offset, false at end of file
+    bool load(uint64_t offset) {
+        if (!loaded_ || offset != next_offset_) {
+            file_.clear();
+            file_.seekg(static_cast<std::streamoff>(offset));
+        }
+        std::vector<unsigned char> block(bgzf::header_size);
+        file_.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size()));
+        std::size_t n = static_cast<std::size_t>(file_.gcount());
+        if (n == 0) return false;
+        std::size_t size = bgzf::block_size(block.data(), n);
+        if (size == 0 || size < n) throw std::runtime_error("Index points outside of the BGZF blocks");
+        block.resize(size);
+        file_.read(reinterpret_cast<char*>(block.data() + n), static_cast<std::streamsize>(size - n));
+        if (static_cast<std::size_t>(file_.gcount()) != size - n) throw std::runtime_error("Truncated BGZF block");
+        current_ = bgzf::inflate_block(block);
+        block_offset_ = offset;
+        next_offset_ = offset + size;
+        loaded_ = true;
+        read_.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// -----------------------------
+// bgzf_chunk_source: Boost.Iostreams source device over a shared BGZFChunkReader
+// -----------------------------
+class bgzf_chunk_source {
+public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    bgzf_chunk_source(const std::string& filename, std::vector<BGZFChunkReader::Chunk> chunks)
+        : reader_(std::make_shared<BGZFChunkReader>(filename, std::move(chunks))) {}
+
+    std::streamsize read(char* s, std::streamsize n) { return reader_->read(s, n); }
+
+    const std::shared_ptr<BGZFChunkReader>& reader() const { return reader_; }
+
+private:
+    std::shared_ptr<BGZFChunkReader> reader_; // devices are copied when pushed onto a chain
+};
+
+// -----------------------------
+// BGZFWriter: Cuts output into 64 KB blocks, deflates them on a thread pool
+// and writes the compressed blocks in order (pigz-style)
+// -----------------------------
+class BGZFWriter {
+public:
+    BGZFWriter(std::ostream& out, unsigned int threads, int level = Z_DEFAULT_COMPRESSION)
+        : out_(&out), level_(level), pool_(threads),
+          window_(static_cast<std::size_t>(std::max(1u, threads)) * 4) {
+        buffer_.reserve(bgzf::block_data_size);
+    }
+
+    ~BGZFWriter() {
+        try { close(); } catch (...) {}
+    }
+
+    void write(const char* s, std::size_t n) {
+        if (tap_) tap_(s, n);
+        while (n > 0) {
+            std::size_t take = std::min(n, bgzf::block_data_size - buffer_.size());
+            buffer_.append(s, take);
+            s += take;
+            n -= take;
+            if (buffer_.size() == bgzf::block_data_size) submit_block();
+        }
+    }
+
+    // Flushes the partial block, waits for all blocks and appends the EOF marker
+    void close() {
+        if (closed_) return;
+        closed_ = true;
+        if (!buffer_.empty()) submit_block();
+        while (!pending_.empty()) write_oldest();
+        out_->write(reinterpret_cast<const char*>(bgzf::eof_block), sizeof(bgzf::eof_block));
+        out_->flush();
+    }
+
+    // Compressed bytes written so far
+    uint64_t compressed_offset() const { return coffset_; }
+
+    // Sees every uncompressed byte, in order, as it is written (e.g. to build an index)
+    void set_tap(std::function<void(const char*, std::size_t)> tap) { tap_ = std::move(tap); }
+
+    // Virtual offset (block offset << 16 | offset in block) of an uncompressed
+    // position. Blocks hold exactly block_data_size bytes, so this is exact once
+    // the block has been written; the end of the data maps to the EOF block.
+    uint64_t virtual_offset(uint64_t position) const {
+        const std::size_t block = static_cast<std::size_t>(position / bgzf::block_data_size);
+        const uint64_t coffset = block < block_offsets_.size() ? block_offsets_[block] : coffset_;
+        return (coffset << 16) | (position % bgzf::block_data_size);
+    }
+
+private:
+    std::ostream* out_;
+    int level_;
+    ThreadPool pool_;
+    std::size_t window_;
+    std::deque<std::future<std::string>> pending_;
+    std::string buffer_;
+    uint64_t coffset_ = 0;
+    std::vector<uint64_t> block_offsets_; // compressed offset of every block written
+    std::function<void(const char*, std::size_t)> tap_;
+    bool closed_ = false;
+
+    void submit_block() {
+        auto data = std::make_shared<std::string>(std::move(buffer_));
+        buffer_ = std::string();
+        buffer_.reserve(bgzf::block_data_size);
+        int level = level_;
+        pending_.push_back(pool_.submit([data, level] { return bgzf::deflate_block(data->data(), data->size(), level); }));
+        // Bound memory: wait for the oldest block once the window is full
+        while (pending_.size() >= window_) write_oldest();
+    }
+
+    void write_oldest() {
+        std::string block = pending_.front().get();
+        pending_.pop_front();
+        out_->write(block.data(), static_cast<std::streamsize>(block.size()));
+        block_offsets_.push_back(coffset_);
+        coffset_ += block.size();
+    }
+};
+
+// -----------------------------
+// bgzf_sink: Boost.Iostreams sink device over a shared BGZFWriter
+// -----------------------------
+class bgzf_sink {
+public:
+    typedef char char_type;
+    struct category : boost::iostreams::sink_tag, boost::iostreams::closable_tag {};
+
+    bgzf_sink(std::ostream& out, unsigned int threads, int level = Z_DEFAULT_COMPRESSION)
+        : writer_(std::make_shared<BGZFWriter>(out, threads, level)) {}
+
+    std::streamsize write(const char* s, std::streamsize n) {
+        writer_->write(s, static_cast<std::size_t>(n));
+        return n;
+    }
+
+    void close() { writer_->close(); }
+
+    const std::shared_ptr<BGZFWriter>& writer() const { return writer_; }
+
+private:
+    std::shared_ptr<BGZFWriter> writer_; // devices are copied when pushed onto a chain
+};
+
+#endif // BGZF_HPP
@@ -0,0 +1,333 @@
+#ifndef BED_SORTER_HPP
+#define BED_SORTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include <unistd.h>
+
+//BOOST INCLUDES
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include "ThreadPool.hpp"
+
+// -----------------------------
+// BedKey: Sort key of a BED row, compared as (chr, start, end)
+// chr is compared bytewise, the order of LC_ALL=C sort -k1,1 -k2,2n -k3,3n
+// -----------------------------
+struct BedKey {
+    std::string_view chr;
+    int64_t start = 0;
+    int64_t end = 0;
+
+    bool operator<(const BedKey& other) const {
+        if (int c = chr.compare(other.chr)) return c < 0;
+        if (start != other.start) return start < other.start;
+        return end < other.end;
+    }
+
+    // Key of one formatted row (without its newline)
+    static BedKey of(std::string_view row) {
+        BedKey key;
+        std::size_t tab = row.find('\t');
+        key.chr = row.substr(0, tab);
+        if (tab == std::string_view::npos) return key;
+        const char* last = row.data() + row.size();
+        auto result = std::from_chars(row.data() + tab + 1, last, key.start);
+        if (result.ptr < last) std::from_chars(result.ptr + 1, last, key.end);
+        return key;
+    }
+};
+
+// -----------------------------
+// parallel_stable_sort: Stable sort of equal slices on a pool, then rounds of
+// pairwise std::inplace_merge until one slice is left
+// -----------------------------
+template <typename It, typename Less>
+void parallel_stable_sort(It first, It last, Less less, unsigned int threads) {
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    const std::size_t min_slice = 1 << 14;
+    const std::size_t slices = std::min<std::size_t>(threads, n / min_slice);
+    if (slices < 2) {
+        std::stable_sort(first, last, less);
+        return;
+    }
+
+    ThreadPool pool(static_cast<unsigned int>(slices));
+    std::vector<std::size_t> bounds;
+    for (std::size_t i = 0; i <= slices; ++i) bounds.push_back(n * i / slices);
+
+    std::vector<std::future<void>> done;
+    for (std::size_t i = 0; i < slices; ++i) {
+        done.push_back(pool.submit([=] { std::stable_sort(first + bounds[i], first + bounds[i + 1], less); }));
+    }
+    for (auto& f : done) f.get();
+
+    // Neighbouring slices only, so equal elements keep their order
+    while (bounds.size() > 2) {
+        done.clear();
+        std::vector<std::size_t> merged{0};
+        for (std::size_t i = 0; i + 2 < bounds.size(); i += 2) {
+            done.push_back(pool.submit([=] {
+                std::inplace_merge(first + bounds[i], first + bounds[i + 1], first + bounds[i + 2], less);
+            }));
+            merged.push_back(bounds[i + 2]);
+        }
+        if ((bounds.size() - 1) % 2 == 1) merged.push_back(bounds.back()); // odd slice out waits a round
+        for (auto& f : done) f.get();
+        bounds = std::move(merged);
+    }
+}
+
+// -----------------------------
+// BedSorter: Orders BED rows by (chr, start, end) within a memory budget
+// Rows arrive as formatted text. While they fit the budget they are kept and
+// sorted in memory; past it, each full buffer is sorted and spilled to a run
+// file in the temp directory and the runs are k-way merged at the end. Rows
+// with equal keys keep their input order, so the result does not depend on
+// the budget or the number of threads.
+// -----------------------------
+class BedSorter {
+public:
+    static constexpr std::size_t max_fan_in = 64;          // runs open at once while merging
+    static constexpr std::size_t run_buffer_size = 1 << 18; // read buffer per open run
+
+    BedSorter(uint64_t memory_budget, unsigned int threads, std::filesystem::path temp_dir)
+        : budget_(std::max<uint64_t>(1, memory_budget)), threads_(std::max(1u, threads)), temp_dir_(std::move(temp_dir)),
+          block_size_(static_cast<std::size_t>(std::clamp<uint64_t>(budget_ / 16, 1 << 16, 8 << 20))) {
+        block_.reserve(block_size_);
+    }
+
+    ~BedSorter() { remove_runs(); }
+
+    BedSorter(const BedSorter&) = delete;
+    BedSorter& operator=(const BedSorter&) = delete;
+
+    // Takes any piece of the row text; rows are cut at newlines
+    void write(const char* s, std::size_t n) {
+        block_.append(s, n);
+        if (block_.size() >= block_size_) seal();
+    }
+
+    // Writes every row received so far to out in sorted order
+    void finish(std::ostream& out) {
+        if (!block_.empty() && block_.back() != '\n') block_.push_back('\n');
+        seal();
+        if (runs_.empty()) {
+            sort_rows();
+            write_rows(out);
+        } else {
+            if (!rows_.empty()) spill();
+            while (runs_.size() > max_fan_in) merge_oldest();
+            merge(runs_, out);
+            remove_runs();
+        }
+        clear();
+    }
+
+    // Sorted runs spilled to disk (0 if everything fit in memory)
+    std::size_t runs() const { return spilled_runs_; }
+    uint64_t spilled_bytes() const { return spilled_bytes_; }
+
+private:
+    // A row in one of the blocks; 32 bytes next to the text it points to
+    struct Row {
+        const char* data;
+        uint32_t length;
+        uint32_t chr_length;
+        int64_t start;
+        int64_t end;
+
+        BedKey key() const { return {std::string_view(data, chr_length), start, end}; }
+        bool operator<(const Row& other) const { return key() < other.key(); }
+    };
+
+    uint64_t budget_;
+    unsigned int threads_;
+    std::filesystem::path temp_dir_;
+    std::size_t block_size_;
+    std::string block_;                // rows still being received
+    std::deque<std::string> blocks_;   // complete rows; a deque never moves them
+    std::vector<Row> rows_;
+    uint64_t block_bytes_ = 0;         // capacity of blocks_
+    std::vector<std::filesystem::path> runs_;
+    std::size_t spilled_runs_ = 0;
+    uint64_t spilled_bytes_ = 0;
+
+    // Indexes the complete rows of block_ and carries the partial last row over
+    void seal() {
+        std::size_t last = block_.rfind('\n');
+        if (last == std::string::npos) return;
+        std::string tail = block_.substr(last + 1);
+        block_.resize(last + 1);
+        blocks_.push_back(std::move(block_));
+        block_ = std::move(tail);
+        block_.reserve(block_size_);
+
+        const std::string& text = blocks_.back();
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            std::size_t nl = text.find('\n', pos);
+            std::string_view row(text.data() + pos, nl - pos);
+            BedKey key = BedKey::of(row);
+            rows_.push_back({row.data(), static_cast<uint32_t>(row.size()), static_cast<uint32_t>(key.chr.size()),
+                             key.start, key.end});
+            pos = nl + 1;
+        }
+        block_bytes_ += text.capacity();
+        if (block_bytes_ + rows_.capacity() * sizeof(Row) >= budget_) spill();
+    }
+
+    void sort_rows() {
+        parallel_stable_sort(rows_.begin(), rows_.end(), std::less<Row>(), threads_);
+    }
+
+    // Writes the buffered rows out in 1 MB pieces
+    void write_rows(std::ostream& out) const {
+        std::string buffer;
+        buffer.reserve((1 << 20) + 4096);
+        for (const Row& row : rows_) {
+            buffer.append(row.data, row.length);
+            buffer.push_back('\n');
+            if (buffer.size() >= (1 << 20)) {
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+    std::filesystem::path next_run_path() const {
+        static std::atomic<uint64_t> counter{0};
+        return temp_dir_ / ("gtf2bed-sort-" + std::to_string(::getpid()) + "-" + std::to_string(counter++) + ".run");
+    }
+
+    // Sorts the buffered rows into a new run file and frees the buffer
+    void spill() {
+        sort_rows();
+        std::filesystem::path path = next_run_path();
+        std::ofstream run(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!run) throw std::runtime_error("Cannot create sort run file: " + path.string());
+        runs_.push_back(path);
+        spilled_runs_++;
+        write_rows(run);
+        run.close();
+        if (!run) throw std::runtime_error("Cannot write sort run file (disk full?): " + path.string());
+        spilled_bytes_ += std::filesystem::file_size(path);
+        clear();
+    }
+
+    void clear() {
+        blocks_.clear();
+        rows_.clear();
+        block_bytes_ = 0;
+    }
+
+    void remove_runs() {
+        std::error_code ec;
+        for (const auto& run : runs_) std::filesystem::remove(run, ec);
+        runs_.clear();
+    }
+
+    // Replaces the max_fan_in oldest runs by their merge, keeping run order
+    void merge_oldest() {
+        std::vector<std::filesystem::path> oldest(runs_.begin(), runs_.begin() + max_fan_in);
+        std::filesystem::path path = next_run_path();
+        {
+            std::ofstream run(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!run) throw std::runtime_error("Cannot create sort run file: " + path.string());
+            merge(oldest, run);
+            run.close();
+            if (!run) throw std::runtime_error("Cannot write sort run file (disk full?): " + path.string());
+        }
+        for (const auto& old : oldest) std::filesystem::remove(old);
+        runs_.erase(runs_.begin(), runs_.begin() + max_fan_in);
+        runs_.insert(runs_.begin(), path);
+    }
+
+    // k-way merge of sorted runs; among equal keys the earlier run wins
+    static void merge(const std::vector<std::filesystem::path>& runs, std::ostream& out) {
+        struct Cursor {
+            std::vector<char> buffer = std::vector<char>(run_buffer_size);
+            std::ifstream in;
+            std::string line;
+            BedKey key;
+
+            bool next() {
+                if (!std::getline(in, line)) return false;
+                key = BedKey::of(line);
+                return true;
+            }
+        };
+        std::vector<std::unique_ptr<Cursor>> cursors;
+        for (const auto& path : runs) {
+            auto cursor = std::make_unique<Cursor>();
+            cursor->in.rdbuf()->pubsetbuf(cursor->buffer.data(), static_cast<std::streamsize>(cursor->buffer.size()));
+            cursor->in.open(path, std::ios::in | std::ios::binary);
+            if (!cursor->in) throw std::runtime_error("Cannot open sort run file: " + path.string());
+            cursors.push_back(std::move(cursor));
+        }
+
+        // std::priority_queue pops the largest, so "after" orders the heap
+        auto after = [&cursors](std::size_t a, std::size_t b) {
+            if (cursors[b]->key < cursors[a]->key) return true;
+            if (cursors[a]->key < cursors[b]->key) return false;
+            return a > b;
+        };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(after)> heap(after);
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            if (cursors[i]->next()) heap.push(i);
+        }
+
+        std::string buffer;
+        buffer.reserve((1 << 20) + 4096);
+        while (!heap.empty()) {
+            std::size_t i = heap.top();
+            heap.pop();
+            buffer.append(cursors[i]->line);
+            buffer.push_back('\n');
+            if (buffer.size() >= (1 << 20)) {
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+            if (cursors[i]->next()) heap.push(i);
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+};
+
+// -----------------------------
+// bed_sorter_sink: Boost.Iostreams sink device feeding a BedSorter
+// -----------------------------
+class bed_sorter_sink {
+public:
+    typedef char char_type;
+    typedef boost::iostreams::sink_tag category;
+
+    explicit bed_sorter_sink(BedSorter& sorter) : sorter_(&sorter) {}
+
+    std::streamsize write(const char* s, std::streamsize n) {
+        sorter_->write(s, static_cast<std::size_t>(n));
+        return n;
+    }
+
+private:
+    BedSorter* sorter_; // devices are copied; the sorter outlives the stream
+};
+
+#endif // BED_SORTER_HPP
@@ -0,0 +1,132 @@
+#ifndef BED_WRITER_HPP
+#define BED_WRITER_HPP
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <algorithm>
+
+// -----------------------------
+// BedWriter: Formats BED rows into one contiguous buffer
+// Fields are appended with memcpy and std::to_chars, and the buffer is handed
+// to the output stream in large blocks instead of one insertion per field.
+// Without a stream the buffer simply grows and is collected with take().
+// -----------------------------
+class BedWriter {
+public:
+    static constexpr std::size_t default_block_size = 1 << 20; // 1 MB
+
+    explicit BedWriter(std::ostream& out, std::size_t block_size = default_block_size)
+        : out_(&out), block_size_(block_size) {
+        buffer_.reserve(block_size_ + (block_size_ >> 4));
+    }
+
+    explicit BedWriter(std::size_t reserve = 0) : out_(nullptr), block_size_(0) {
+        buffer_.reserve(reserve);
+    }
+
+    // Appends to buffer without a stream; take() hands it back
+    explicit BedWriter(std::string&& buffer) : out_(nullptr), block_size_(0), buffer_(std::move(buffer)) {}
+
+    ~BedWriter() { flush(); }
+
+    BedWriter(const BedWriter&) = delete;
+    BedWriter& operator=(const BedWriter&) = delete;
+
+    void append(std::string_view s) { buffer_.append(s.data(), s.size()); }
+    void append(char c) { buffer_.push_back(c); }
+
+    void append(int64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr - digits);
+    }
+
+    // Appends n missing-value cells ("\t.") in one copy
+    void append_missing(std::size_t n) {
+        static const std::string run = [] {
+            std::string s;
+            for (int i = 0; i < 64; ++i) s += "\t.";
+            return s;
+        }();
+        while (n > 0) {
+            std::size_t k = std::min<std::size_t>(n, run.size() / 2);
+            buffer_.append(run.data(), 2 * k);
+            n -= k;
+        }
+    }
+
+    // Ends a row; hands the buffer to the stream once a block is full
+    void end_row() {
+        buffer_.push_back('\n');
+        if (out_ && buffer_.size() >= block_size_) flush();
+    }
+
+    void flush() {
+        if (!out_ || buffer_.empty()) return;
+        out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    // Formatted bytes not yet flushed (everything, for a writer without stream)
+    std::string take() { return std::move(buffer_); }
+    std::size_t size() const { return buffer_.size(); }
+
+private:
+    std::ostream* out_;
+    std::size_t block_size_;
+    std::string buffer_;
+};
+
+// -----------------------------
+// write_bed_header: Standard columns plus one column per attribute key
+// -----------------------------
+inline void write_bed_header(std::ostream& out, const std::vector<std::string>& keys) {
+    out << "#chr\tstart\tend\tid\tinfo\tstrand";
+    for (const std::string& key : keys) out << "\t" << key;
+    out << "\n";
+}
+
+// -----------------------------
+// write_bed_row: One record as a BED row, the attribute columns in the order of keys
+// find(line, key) returns the record's value of key, or something false if it has none;
+// gene_id is the key of the BED name. Throws std::out_of_range for a record without it.
+// -----------------------------
+template <typename Line, typename Key, typename Find>
+inline void write_bed_row(BedWriter& bed, const Line& line, const Key& gene_id, const std::vector<Key>& keys, Find&& find) {
+    const auto id = find(line, gene_id);
+    if (!id) throw std::out_of_range("Line without gene_id attribute");
+
+    bed.append(line.seqname);
+    bed.append('\t');
+    bed.append(static_cast<int64_t>(line.start) - 1);  // Convert to 0-based start
+    bed.append('\t');
+    bed.append(static_cast<int64_t>(line.end));        // Keep 1-based end
+    bed.append('\t');
+    bed.append(*id);                                   // Use gene_id as BED name
+    bed.append('\t');
+    bed.append(line.feature);                          // Feature type in info field
+    bed.append('\t');
+    bed.append(line.score);                            // Score field
+
+    // Add all attributes in order; runs of missing ones are filled with "." at once
+    std::size_t missing = 0;
+    for (const Key& key : keys) {
+        if (const auto value = find(line, key)) {
+            bed.append_missing(missing);
+            missing = 0;
+            bed.append('\t');
+            bed.append(*value);
+        } else {
+            missing++;
+        }
+    }
+    bed.append_missing(missing);
+    bed.end_row();
+}
+
+#endif // BED_WRITER_HPP
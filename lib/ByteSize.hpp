@@ -0,0 +1,40 @@
+#ifndef BYTE_SIZE_HPP
+#define BYTE_SIZE_HPP
+
+#include <string>
+#include <charconv>
+#include <cctype>
+#include <cstdint>
+
+#include <unistd.h>
+
+// -----------------------------
+// parse_size: Reads a size such as 500000, 64K, 10M or 20G (powers of 1024)
+// Returns 0 if the text is not a size or does not fit in 64 bits.
+// -----------------------------
+inline uint64_t parse_size(const std::string& text) {
+    uint64_t value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) return 0;
+    std::string unit(result.ptr, text.data() + text.size());
+    for (char& c : unit) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    int shift = 0;
+    if (unit == "K" || unit == "KB") shift = 10;
+    else if (unit == "M" || unit == "MB") shift = 20;
+    else if (unit == "G" || unit == "GB") shift = 30;
+    else if (!unit.empty() && unit != "B") return 0;
+    if (value > (UINT64_MAX >> shift)) return 0;
+    return value << shift;
+}
+
+// -----------------------------
+// physical_memory_bytes: Installed RAM, 0 if it cannot be determined
+// -----------------------------
+inline uint64_t physical_memory_bytes() {
+    long pages = ::sysconf(_SC_PHYS_PAGES);
+    long page_size = ::sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) return 0;
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+}
+
+#endif // BYTE_SIZE_HPP
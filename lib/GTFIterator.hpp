@@ -2,17 +2,33 @@
 #define GTF_ITERATOR_HPP
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <fstream>
 #include <sstream>
 #include <iterator>
 #include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <array>
 
 //BOOST INCLUDES
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
 
+#include "BGZF.hpp"
+#include "KeyDictionary.hpp"
+#include "Tokenizer.hpp"
+#include "RunStats.hpp"
+#include "RegionSet.hpp"
+
 // -----------------------------
 // FileFormat: Enum for different file formats
 // -----------------------------
@@ -23,7 +39,7 @@ enum class FileFormat {
 };
 
 // -----------------------------
-// GTFLine: Represents a line in a GTF/GFF file
+// GTFLine: Represents a line in a GTF/GFF file (owning copy)
 // -----------------------------
 struct GTFLine {
     std::string seqname;
@@ -34,198 +50,641 @@ struct GTFLine {
     std::string score;
     char strand = '.';
     std::string frame;
-    std::unordered_map<std::string, std::string> attributes;
+    AttributeList attributes;
 };
 
 // -----------------------------
-// GTFIterator: Input iterator for GTF/GFF files
+// GTFAttribute: One key/value pair of the attribute column
 // -----------------------------
-class GTFIterator {
+struct GTFAttribute {
+    std::string_view key;
+    std::string_view value;
+    uint32_t id; // interned key, see KeyDictionary
+};
+
+// -----------------------------
+// GTFLineView: Non-owning view of a parsed GTF/GFF line
+// Fields point into the reader buffer (or the parser's decode buffer) and
+// are only valid until the iterator is advanced. Use to_line() to keep a copy.
+// -----------------------------
+struct GTFLineView {
+    std::string_view seqname;
+    std::string_view source;
+    std::string_view feature;
+    int64_t start = 0;
+    int64_t end = 0;
+    std::string_view score;
+    char strand = '.';
+    std::string_view frame;
+    std::vector<GTFAttribute> attributes;
+    std::string_view raw_attributes; // unparsed column 9, for keys left out by a projection
+
+    // Returns the value of key, or nullptr. Later duplicates win, as they did in the map.
+    const std::string_view* find(std::string_view key) const {
+        for (auto it = attributes.rbegin(); it != attributes.rend(); ++it) {
+            if (it->key == key) return &it->value;
+        }
+        return nullptr;
+    }
+
+    // Same lookup by interned key id: integer compares only
+    const std::string_view* find(uint32_t id) const {
+        for (auto it = attributes.rbegin(); it != attributes.rend(); ++it) {
+            if (it->id == id) return &it->value;
+        }
+        return nullptr;
+    }
+
+    GTFLine to_line() const {
+        GTFLine gtf;
+        gtf.seqname = seqname;
+        gtf.source = source;
+        gtf.feature = feature;
+        gtf.start = static_cast<int>(start);
+        gtf.end = static_cast<int>(end);
+        gtf.score = score;
+        gtf.strand = strand;
+        gtf.frame = frame;
+        gtf.attributes.reserve(attributes.size());
+        for (const GTFAttribute& attr : attributes) {
+            gtf.attributes.set(attr.id, attr.value);
+        }
+        return gtf;
+    }
+};
+
+// -----------------------------
+// LineReader: Hands out lines from a large read buffer without copying them
+// -----------------------------
+class LineReader {
 public:
-    using iterator_category = std::input_iterator_tag;
-    using value_type        = GTFLine;
-    using difference_type   = std::ptrdiff_t;
-    using pointer           = const GTFLine*;
-    using reference         = const GTFLine&;
+    static constexpr std::size_t default_buffer_size = 1 << 22; // 4 MB
 
-    GTFIterator() : stream_(nullptr), format_(FileFormat::GTF) {}
+    explicit LineReader(std::istream& stream, std::size_t buffer_size = default_buffer_size,
+                        ReadCounters* counters = nullptr, std::atomic<uint64_t>* consumed = nullptr)
+        : stream_(&stream), buffer_(buffer_size), counters_(counters), consumed_(consumed) {}
 
-    explicit GTFIterator(std::ifstream& stream, FileFormat format = FileFormat::GTF) 
-        : stream_(&stream), format_(format) {
-        ++(*this); // Load first valid line
+    // Returns the next line (without '\n'); the view is valid until the next call
+    bool next(std::string_view& line) {
+        while (true) {
+            const char* nl = static_cast<const char*>(
+                std::memchr(buffer_.data() + scan_, '\n', end_ - scan_));
+            if (nl) {
+                std::size_t pos = nl - buffer_.data();
+                line = std::string_view(buffer_.data() + begin_, pos - begin_);
+                begin_ = scan_ = pos + 1;
+                return true;
+            }
+            scan_ = end_;
+            if (eof_) {
+                if (begin_ == end_) return false;
+                line = std::string_view(buffer_.data() + begin_, end_ - begin_);
+                begin_ = scan_ = end_;
+                return true;
+            }
+            refill();
+        }
     }
 
-    reference operator*() const { return current_; }
-    pointer operator->() const { return &current_; }
+private:
+    std::istream* stream_;
+    std::vector<char> buffer_;
+    ReadCounters* counters_;  // optional, for --stats
+    std::atomic<uint64_t>* consumed_; // optional, bytes taken from the stream (progress)
+    std::size_t begin_ = 0; // start of the current (unfinished) line
+    std::size_t scan_ = 0;  // bytes before this position contain no newline
+    std::size_t end_ = 0;   // end of valid data
+    bool eof_ = false;
 
-    // Prefix increment
-    GTFIterator& operator++() {
-        std::string line;
-        while (std::getline(*stream_, line)) {
-            if (line.empty() || line[0] == '#') continue; // skip comments and empty lines
-            current_ = parse_line(line);
-            return *this;
+    void refill() {
+        // Move the partial line to the front; grow only for lines longer than the buffer
+        std::size_t pending = end_ - begin_;
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, pending);
+            scan_ -= begin_;
+            begin_ = 0;
+            end_ = pending;
         }
-        stream_ = nullptr; // EOF
-        return *this;
+        if (end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+        const double wall = counters_ ? run_stats::wall_seconds() : 0, cpu = counters_ ? run_stats::cpu_seconds() : 0;
+        stream_->read(buffer_.data() + end_, buffer_.size() - end_);
+        if (stream_->bad()) throw std::runtime_error("Error while reading input (corrupted or truncated file?)");
+        std::streamsize n = stream_->gcount();
+        if (consumed_ && n > 0) consumed_->fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        if (counters_) {
+            counters_->bytes += static_cast<uint64_t>(n > 0 ? n : 0);
+            counters_->time.add({run_stats::wall_seconds() - wall, run_stats::cpu_seconds() - cpu});
+        }
+        if (n <= 0) eof_ = true;
+        end_ += static_cast<std::size_t>(n > 0 ? n : 0);
     }
+};
 
-    // Postfix increment
-    GTFIterator operator++(int) {
-        GTFIterator tmp = *this;
-        ++(*this);
-        return tmp;
+// -----------------------------
+// FeatureFilter: Decides from column 3 whether a line is kept, and records
+// every feature type seen so requested types can be validated afterwards
+// -----------------------------
+class FeatureFilter {
+public:
+    using StringSet = std::unordered_set<std::string, string_hash, std::equal_to<>>;
+
+    FeatureFilter() {}
+
+    // An empty set or the single value "all" keeps every line
+    explicit FeatureFilter(const std::unordered_set<std::string>& features)
+        : all_(features.empty() || (features.size() == 1 && *features.begin() == "all")),
+          accepted_(features.begin(), features.end()) {}
+
+    FeatureFilter(const FeatureFilter& other)
+        : all_(other.all_), accepted_(other.accepted_), seen_(other.seen_),
+          kept_(other.kept_), rejected_(other.rejected_) {}
+    FeatureFilter& operator=(const FeatureFilter&) = delete;
+
+    // A filter with the same selection that has not seen anything yet, e.g. for a worker
+    FeatureFilter selection() const {
+        FeatureFilter fresh;
+        fresh.all_ = all_;
+        fresh.accepted_ = accepted_;
+        return fresh;
     }
 
-    friend bool operator==(const GTFIterator& a, const GTFIterator& b) {
-        return a.stream_ == b.stream_;
+    bool accept(std::string_view feature) {
+        if (!last_ || *last_ != feature) {
+            auto it = seen_.find(feature);
+            if (it == seen_.end()) it = seen_.emplace(feature).first;
+            last_ = &*it;
+        }
+        bool keep = all_ || accepted_.find(feature) != accepted_.end();
+        (keep ? kept_ : rejected_)++;
+        return keep;
     }
 
-    friend bool operator!=(const GTFIterator& a, const GTFIterator& b) {
-        return !(a == b);
+    // Folds in what another filter (e.g. a worker's copy) has seen
+    void merge(FeatureFilter& other) {
+        seen_.merge(other.seen_);
+        kept_ += other.kept_;
+        rejected_ += other.rejected_;
     }
 
+    bool accepts_all() const { return all_; }
+    const StringSet& seen() const { return seen_; }
+    uint64_t kept() const { return kept_; }
+    uint64_t rejected() const { return rejected_; }
+
 private:
-    std::ifstream* stream_;
-    GTFLine current_;
-    FileFormat format_;
+    bool all_ = true;
+    StringSet accepted_;
+    StringSet seen_;
+    const std::string* last_ = nullptr;
+    uint64_t kept_ = 0;
+    uint64_t rejected_ = 0;
+};
 
-    // Parses a line into a GTFLine structure based on format
-    GTFLine parse_line(const std::string& line) {
-        std::istringstream iss(line);
-        GTFLine gtf;
-        std::string attr_field;
+// -----------------------------
+// GTFParser: Splits a line into a GTFLineView without allocating
+// -----------------------------
+class GTFParser {
+public:
+    explicit GTFParser(FileFormat format = FileFormat::GTF, FeatureFilter* filter = nullptr,
+                       const RegionSet* regions = nullptr)
+        : format_(format), filter_(filter), regions_(regions) {}
 
-        iss >> gtf.seqname >> gtf.source >> gtf.feature
-            >> gtf.start >> gtf.end >> gtf.score
-            >> gtf.strand >> gtf.frame;
+    // Parses a line into a GTFLineView structure based on format.
+    // Returns false, without touching the attributes, if the line lies outside the
+    // regions or the filter rejects the feature.
+    bool parse_line(std::string_view line, GTFLineView& gtf) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
 
-        std::getline(iss, attr_field); // Get attribute field
+        // One vector scan finds the first eight tabs
+        positions_.clear();
+        find_separators(line, '\t', positions_, 8);
 
-        switch (format_) {
-            case FileFormat::GTF:
-                parse_gtf_attributes(attr_field, gtf.attributes);
-                break;
-            case FileFormat::GFF:
-                parse_gff_attributes(attr_field, gtf.attributes);
-                break;
-            case FileFormat::GFF3:
-                parse_gff3_attributes(attr_field, gtf.attributes);
-                break;
+        std::string_view fields[8];
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < 8; ++i) {
+            if (i < positions_.size()) {
+                fields[i] = line.substr(pos, positions_[i] - pos);
+                pos = positions_[i] + 1;
+            } else {
+                fields[i] = line.substr(std::min(pos, line.size()));
+                pos = line.size() + 1;
+            }
+            // Other sequences are dropped before anything else is split
+            if (i == 0 && regions_ && !select_sequence(fields[0])) return false;
         }
+        // Decide on the position and feature type before touching the attributes
+        if (regions_ && !RegionSet::overlaps(*intervals_, to_int(fields[3]) - 1, to_int(fields[4]))) return false;
+        if (filter_ && !filter_->accept(fields[2])) return false;
+        std::string_view attr_field = pos < line.size() ? line.substr(pos) : std::string_view();
 
-        return gtf;
-    }
+        gtf.seqname = fields[0];
+        gtf.source = fields[1];
+        gtf.feature = fields[2];
+        gtf.start = to_int(fields[3]);
+        gtf.end = to_int(fields[4]);
+        gtf.score = fields[5];
+        gtf.strand = fields[6].empty() ? '.' : fields[6][0];
+        gtf.frame = fields[7];
+        gtf.attributes.clear();
+        gtf.raw_attributes = attr_field;
+
+        // Decoded values never outgrow their source, so reserving keeps views stable
+        decoded_.clear();
+        decoded_.reserve(attr_field.size());
 
-    // Parse GTF format attributes: key "value"; key "value";
-    void parse_gtf_attributes(const std::string& attr_field, std::unordered_map<std::string, std::string>& attributes) {
-        std::istringstream attr_stream(attr_field);
-        std::string token;
-        while (std::getline(attr_stream, token, ';')) {
-            std::istringstream pair_stream(token);
-            std::string key, value;
-            pair_stream >> key;
-
-            if (!key.empty()) {
-                pair_stream >> std::ws; // skip whitespace
-                std::getline(pair_stream, value, '"'); // skip to quote
-                std::getline(pair_stream, value, '"'); // actual value
-                attributes[key] = value;
+        for_each_attribute(format_, attr_field, positions_, [&](std::string_view key, std::string_view value, bool encoded) {
+            uint32_t id;
+            if (projection_.empty()) {
+                id = keys_.id(key);
+            } else if ((id = projected_id(key)) == KeyDictionary::npos) {
+                return; // not requested: neither interned nor decoded
             }
+            gtf.attributes.push_back({key, encoded ? url_decode(value) : value, id});
+        });
+        return true;
+    }
+
+    // Only the given keys are materialised by parse_line; an empty list parses all of them
+    void project(const std::vector<std::string>& keys) {
+        projection_.clear();
+        for (const std::string& key : keys) {
+            if (projected_id(key) == KeyDictionary::npos) projection_.emplace_back(key, key_dictionary().id(key));
         }
     }
 
-    // Parse GFF format attributes: key value; key value;
-    void parse_gff_attributes(const std::string& attr_field, std::unordered_map<std::string, std::string>& attributes) {
-        std::istringstream attr_stream(attr_field);
-        std::string token;
-        while (std::getline(attr_stream, token, ';')) {
-            size_t eq_pos = token.find('=');
-            if (eq_pos != std::string::npos) {
-                std::string key = token.substr(0, eq_pos);
-                std::string value = token.substr(eq_pos + 1);
-                
-                // Trim leading/trailing whitespace
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                
-                // URL decode value for GFF3 (handle %20, %3D, etc.)
-                attributes[key] = url_decode(value);
+    const std::vector<std::pair<std::string, uint32_t>>& projection() const { return projection_; }
+
+    // Looks key up in the raw attribute column of line, including keys the projection
+    // skipped. The (decoded) value is written to value; later duplicates win.
+    bool find_unparsed(const GTFLineView& line, std::string_view key, std::string& value) const {
+        bool found = false;
+        std::vector<uint32_t> positions;
+        for_each_attribute(format_, line.raw_attributes, positions, [&](std::string_view k, std::string_view v, bool encoded) {
+            if (k != key) return;
+            value.clear();
+            if (encoded) decode_into(value, v);
+            else value.assign(v);
+            found = true;
+        });
+        return found;
+    }
+
+    // URL decoder for GFF/GFF3 values: appends the decoded str to out
+    static void decode_into(std::string& out, std::string_view str) {
+        std::size_t i = 0;
+        while (i < str.size()) {
+            const char* percent = static_cast<const char*>(std::memchr(str.data() + i, '%', str.size() - i));
+            std::size_t next = percent ? percent - str.data() : str.size();
+            out.append(str.data() + i, next - i); // run without escapes in one copy
+            if (!percent) break;
+
+            // An escape needs two more characters and must not end the value
+            char value;
+            if (next + 2 < str.size() && decode_escape(str[next + 1], str[next + 2], value)) {
+                out += value;
+                i = next + 3;
+            } else {
+                out += '%';
+                i = next + 1;
             }
         }
     }
 
-    // Parse GFF3 format attributes: key=value;key=value;
-    void parse_gff3_attributes(const std::string& attr_field, std::unordered_map<std::string, std::string>& attributes) {
-        std::istringstream attr_stream(attr_field);
-        std::string token;
-        while (std::getline(attr_stream, token, ';')) {
-            size_t eq_pos = token.find('=');
-            if (eq_pos != std::string::npos) {
-                std::string key = token.substr(0, eq_pos);
-                std::string value = token.substr(eq_pos + 1);
-                
-                // Trim leading/trailing whitespace
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                
-                // URL decode value for GFF3 (handle %20, %3D, etc.)
-                attributes[key] = url_decode(value);
-            }
+private:
+    FileFormat format_;
+    FeatureFilter* filter_;
+    const RegionSet* regions_;
+    std::string sequence_;                         // last seqname looked up in regions_
+    const RegionSet::Intervals* intervals_ = nullptr; // its intervals, nullptr if it has none
+    std::string decoded_; // backing store for url-decoded values of the current line
+    KeyCache keys_;       // key -> id without locking the global dictionary
+    std::vector<uint32_t> positions_; // separator offsets of the field being split
+    std::vector<std::pair<std::string, uint32_t>> projection_; // requested keys and their ids
+
+    // A handful of requested keys: a linear scan beats hashing every key of the line
+    uint32_t projected_id(std::string_view key) const {
+        for (const auto& [name, id] : projection_) {
+            if (name == key) return id;
+        }
+        return KeyDictionary::npos;
+    }
+
+    // Lines come grouped by sequence: the set is only searched when the seqname changes
+    bool select_sequence(std::string_view seqname) {
+        if (seqname != sequence_ || sequence_.empty()) {
+            sequence_.assign(seqname);
+            intervals_ = regions_->find(seqname);
+        }
+        return intervals_ != nullptr;
+    }
+
+    static constexpr std::string_view whitespace = " \t\n\v\f\r";
+
+    static int64_t to_int(std::string_view s) {
+        int64_t value = 0;
+        std::from_chars(s.data(), s.data() + s.size(), value);
+        return value;
+    }
+
+    static std::string_view trim(std::string_view s) {
+        std::size_t first = s.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return {};
+        std::size_t last = s.find_last_not_of(" \t");
+        return s.substr(first, last - first + 1);
+    }
+
+    // Calls fn(key, value, encoded) for every attribute of the field. GFF and GFF3
+    // values are still url-encoded; the caller decides whether to decode them.
+    // positions is scratch space for the separator offsets.
+    template <typename Fn>
+    static void for_each_attribute(FileFormat format, std::string_view attr_field,
+                                   std::vector<uint32_t>& positions, Fn&& fn) {
+        positions.clear();
+        if (format == FileFormat::GTF) {
+            find_separators(attr_field, SeparatorSet(';', '"'), positions);
+            for_each_gtf_attribute(attr_field, positions, fn);
+        } else {
+            // GFF and GFF3 share the key=value layout
+            find_separators(attr_field, SeparatorSet(';', '='), positions);
+            for_each_gff3_attribute(attr_field, positions, fn);
+        }
+    }
+
+    // Calls fn(token_begin, token_end, first, last) for every ';'-separated token, where
+    // positions[first, last) are the other separators inside the token
+    template <typename Fn>
+    static void for_each_token(std::string_view attr_field, const std::vector<uint32_t>& positions, Fn&& fn) {
+        std::size_t pos = 0;
+        std::size_t k = 0;
+        while (pos < attr_field.size()) {
+            std::size_t first = k;
+            while (k < positions.size() && attr_field[positions[k]] != ';') ++k;
+            std::size_t semi = k < positions.size() ? positions[k] : attr_field.size();
+            fn(pos, semi, first, k);
+            pos = semi + 1;
+            ++k;
         }
     }
 
-    // Simple URL decoder for GFF3 format
-    std::string url_decode(const std::string& str) {
-        std::string result;
-        for (size_t i = 0; i < str.length(); ++i) {
-            if (str[i] == '%' && i + 2 < str.length()) {
-                int value;
-                std::istringstream hex_stream(str.substr(i + 1, 2));
-                if (hex_stream >> std::hex >> value) {
-                    result += static_cast<char>(value);
-                    i += 2;
-                } else {
-                    result += str[i];
-                }
+    // GTF format attributes: key "value"; key "value";
+    template <typename Fn>
+    static void for_each_gtf_attribute(std::string_view attr_field, const std::vector<uint32_t>& positions, Fn& fn) {
+        for_each_token(attr_field, positions, [&](std::size_t begin, std::size_t end, std::size_t first, std::size_t last) {
+            std::string_view token = attr_field.substr(begin, end - begin);
+            std::size_t key_begin = token.find_first_not_of(whitespace);
+            if (key_begin == std::string_view::npos) return;
+            std::size_t key_end = token.find_first_of(whitespace, key_begin);
+            if (key_end == std::string_view::npos) key_end = token.size();
+
+            std::string_view key = token.substr(key_begin, key_end - key_begin);
+            std::size_t value_begin = token.find_first_not_of(whitespace, key_end);
+            if (value_begin == std::string_view::npos) {
+                fn(key, std::string_view(), false);
+                return;
+            }
+
+            // Value sits between the first pair of quotes; unquoted values are taken as is
+            value_begin += begin;
+            while (first < last && positions[first] < value_begin) ++first;
+            if (first < last) {
+                std::size_t open = positions[first] + 1;
+                std::size_t close = first + 1 < last ? positions[first + 1] : end;
+                fn(key, attr_field.substr(open, close - open), false);
             } else {
-                result += str[i];
+                fn(key, attr_field.substr(value_begin, end - value_begin), false);
+            }
+        });
+    }
+
+    // GFF3 format attributes: key=value;key=value;
+    template <typename Fn>
+    static void for_each_gff3_attribute(std::string_view attr_field, const std::vector<uint32_t>& positions, Fn& fn) {
+        for_each_token(attr_field, positions, [&](std::size_t begin, std::size_t end, std::size_t first, std::size_t last) {
+            if (first == last) return; // no '=' in this token
+            std::size_t eq_pos = positions[first];
+            // URL decode value for GFF3 (handle %20, %3D, etc.)
+            fn(trim(attr_field.substr(begin, eq_pos - begin)), trim(attr_field.substr(eq_pos + 1, end - eq_pos - 1)), true);
+        });
+    }
+
+    // Hex digit values, -1 for any other byte
+    static constexpr std::array<int8_t, 256> hex_table = [] {
+        std::array<int8_t, 256> table{};
+        for (int c = 0; c < 256; ++c) {
+            table[c] = c >= '0' && c <= '9' ? c - '0'
+                     : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                     : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        }
+        return table;
+    }();
+
+    // Value of the two characters after a '%', read the way istringstream >> std::hex
+    // always did here: a digit pair, one digit followed by anything, or a digit after
+    // one whitespace or sign character. "0x" on its own is rejected.
+    static bool decode_escape(unsigned char a, unsigned char b, char& value) {
+        int high = hex_table[a];
+        int low = hex_table[b];
+        if (high >= 0) {
+            if (low >= 0) {
+                value = static_cast<char>(high * 16 + low);
+                return true;
             }
+            if (a == '0' && (b == 'x' || b == 'X')) return false;
+            value = static_cast<char>(high);
+            return true;
         }
-        return result;
+        if (low < 0) return false;
+        if (a == '-') {
+            value = static_cast<char>(-low);
+            return true;
+        }
+        if (a == '+' || whitespace.find(static_cast<char>(a)) != std::string_view::npos) {
+            value = static_cast<char>(low);
+            return true;
+        }
+        return false;
+    }
+
+    // Values without escapes are returned as they are, without copying
+    std::string_view url_decode(std::string_view str) {
+        if (str.empty() || !std::memchr(str.data(), '%', str.size())) return str;
+        std::size_t first = decoded_.size();
+        decode_into(decoded_, str);
+        return std::string_view(decoded_).substr(first);
     }
 };
 
+// -----------------------------
+// GTFIterator: Input iterator for GTF/GFF files
+// -----------------------------
+class GTFIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type        = GTFLineView;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const GTFLineView*;
+    using reference         = const GTFLineView&;
+
+    GTFIterator() {}
+
+    explicit GTFIterator(std::istream& stream, FileFormat format = FileFormat::GTF, FeatureFilter* filter = nullptr,
+                         const std::vector<std::string>& projection = {}, ReadCounters* counters = nullptr,
+                         std::atomic<uint64_t>* consumed = nullptr, const RegionSet* regions = nullptr)
+        : state_(std::make_shared<State>(stream, format, filter, counters, consumed, regions)) {
+        state_->parser.project(projection);
+        ++(*this); // Load first valid line
+    }
+
+    reference operator*() const { return state_->current; }
+    pointer operator->() const { return &state_->current; }
+
+    // Parser of the current line, e.g. for find_unparsed() on projected lines
+    const GTFParser& parser() const { return state_->parser; }
+
+    // Prefix increment
+    GTFIterator& operator++() {
+        std::string_view line;
+        while (state_->reader.next(line)) {
+            if (line.empty() || line[0] == '#') continue; // skip comments and empty lines
+            if (!state_->parser.parse_line(line, state_->current)) continue; // filtered out
+            return *this;
+        }
+        state_ = nullptr; // EOF
+        return *this;
+    }
+
+    // Postfix increment
+    GTFIterator operator++(int) {
+        GTFIterator tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    friend bool operator==(const GTFIterator& a, const GTFIterator& b) {
+        return a.state_ == b.state_;
+    }
+
+    friend bool operator!=(const GTFIterator& a, const GTFIterator& b) {
+        return !(a == b);
+    }
+
+private:
+    // Shared so that copies of an input iterator advance the same stream
+    struct State {
+        State(std::istream& stream, FileFormat format, FeatureFilter* filter, ReadCounters* counters,
+              std::atomic<uint64_t>* consumed, const RegionSet* regions)
+            : reader(stream, LineReader::default_buffer_size, counters, consumed), parser(format, filter, regions) {}
+        LineReader reader;
+        GTFParser parser;
+        GTFLineView current;
+    };
+    std::shared_ptr<State> state_;
+};
+
 // -----------------------------
 // GTFFile: Range wrapper for using GTFIterator in for-loops
+// Plain text is read straight from the file; gzip and bzip2 go through the
+// decompressor chain, and BGZF blocks are inflated on a pool of threads.
 // -----------------------------
 class GTFFile: public boost::iostreams::filtering_istream {
 
 protected:
     std::ifstream file_descriptor;
+    std::string filename_;
     FileFormat format_;
+    Compression compression_;
+    FeatureFilter* filter_ = nullptr;
+    const RegionSet* regions_ = nullptr;
+    std::vector<std::string> projection_;
+    ReadCounters* counters_ = nullptr;
+    std::atomic<uint64_t> consumed_{0};     // bytes read from the file on disk
+    std::shared_ptr<BGZFReader> bgzf_;      // BGZF input keeps its own offset
+    std::shared_ptr<BGZFChunkReader> chunks_; // ... and so does indexed BGZF input
+
+    // Source over the file that counts the (compressed) bytes taken from it
+    class counted_source {
+    public:
+        typedef char char_type;
+        typedef boost::iostreams::source_tag category;
+
+        counted_source(std::istream& in, std::atomic<uint64_t>& count) : in_(&in), count_(&count) {}
+
+        std::streamsize read(char* s, std::streamsize n) {
+            in_->read(s, n);
+            std::streamsize got = in_->gcount();
+            if (got <= 0) return -1;
+            count_->fetch_add(static_cast<uint64_t>(got), std::memory_order_relaxed);
+            return got;
+        }
+
+    private:
+        std::istream* in_;
+        std::atomic<uint64_t>* count_;
+    };
 
 public:
-    explicit GTFFile(const std::string& filename, FileFormat format = FileFormat::GTF) 
-        : format_(format) {
-        if (filename.substr(filename.find_last_of(".") + 1) == "gz") {
-            file_descriptor.open(filename.c_str(), std::ios::in | std::ios::binary);
-            push(boost::iostreams::gzip_decompressor());
-        } else if (filename.substr(filename.find_last_of(".") + 1) == "bz2") {
-            file_descriptor.open(filename.c_str(), std::ios::in | std::ios::binary);
-            push(boost::iostreams::bzip2_decompressor());
-        } else {
-            file_descriptor.open(filename.c_str());
+    explicit GTFFile(const std::string& filename, FileFormat format = FileFormat::GTF, unsigned int threads = 1)
+        : filename_(filename), format_(format), compression_(detect_compression(filename)) {
+        switch (compression_) {
+            case Compression::BGZF: {
+                bgzf_source source(filename, threads);
+                bgzf_ = source.reader();
+                push(source);
+                return;
+            }
+            case Compression::GZIP:
+                file_descriptor.open(filename.c_str(), std::ios::in | std::ios::binary);
+                push(boost::iostreams::gzip_decompressor());
+                break;
+            case Compression::BZIP2:
+                file_descriptor.open(filename.c_str(), std::ios::in | std::ios::binary);
+                push(boost::iostreams::bzip2_decompressor());
+                break;
+            case Compression::NONE:
+                file_descriptor.open(filename.c_str(), std::ios::in | std::ios::binary);
+                return; // no filters: the iterator reads the file directly
         }
-        if (!file_descriptor.fail()) push(file_descriptor);
+        if (!file_descriptor.fail()) push(counted_source(file_descriptor, consumed_));
     }
 
+    Compression compression() const { return compression_; }
+
+    // Bytes of the file on disk read so far (compressed bytes for compressed input).
+    // Safe to call from another thread, e.g. a progress reporter.
+    uint64_t consumed_bytes() const {
+        if (chunks_) return chunks_->compressed_offset();
+        return bgzf_ ? bgzf_->compressed_offset() : consumed_.load(std::memory_order_relaxed);
+    }
+
+    // Lines whose feature type the filter rejects are skipped before attribute parsing
+    void set_filter(FeatureFilter* filter) { filter_ = filter; }
+
+    // Lines that do not overlap the regions are skipped, other sequences before their
+    // coordinates are read. The set must outlive the iteration.
+    void set_regions(const RegionSet* regions) { regions_ = regions; }
+
+    // Reads only these ranges of BGZF input (virtual offsets, e.g. from a tabix
+    // index) instead of the whole file. The ranges must start and end on lines.
+    void read_chunks(std::vector<BGZFChunkReader::Chunk> chunks) {
+        if (compression_ != Compression::BGZF) throw std::invalid_argument("Only BGZF input can be read through an index");
+        reset();
+        bgzf_ = nullptr;
+        bgzf_chunk_source source(filename_, std::move(chunks));
+        chunks_ = source.reader();
+        push(source);
+    }
+
+    // Only these attribute keys are parsed (all of them if empty)
+    void set_projection(std::vector<std::string> keys) { projection_ = std::move(keys); }
+
+    // Bytes read and time spent reading/decompressing are added to counters
+    void set_read_counters(ReadCounters* counters) { counters_ = counters; }
+
     GTFIterator begin() {
-        return GTFIterator(file_descriptor, format_);
+        if (compression_ == Compression::NONE) {
+            return GTFIterator(file_descriptor, format_, filter_, projection_, counters_, &consumed_, regions_);
+        }
+        return GTFIterator(*this, format_, filter_, projection_, counters_, nullptr, regions_);
     }
 
     GTFIterator end() {
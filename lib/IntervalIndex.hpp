@@ -0,0 +1,270 @@
+#ifndef INTERVAL_INDEX_HPP
+#define INTERVAL_INDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <optional>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
+
+#include "KeyDictionary.hpp"
+
+// -----------------------------
+// IntervalIndex: Overlap and nearest queries over the intervals of many sequences
+// Per sequence the intervals sit in one array sorted by start, which doubles as
+// an implicit augmented binary tree (the layout of cgranges): the node at index
+// i has level = number of trailing 1 bits of i, and stores the largest end of
+// its subtree. Queries descend only into subtrees whose largest end passes the
+// query start, so they cost O(log n + hits) without any per-node allocation.
+// Coordinates are 0-based and half-open; value is the caller's id of a row.
+// -----------------------------
+class IntervalIndex {
+public:
+    struct Interval {
+        int64_t begin;
+        int64_t end;
+        int64_t max_end;   // largest end in the subtree rooted here
+        uint32_t value;
+    };
+
+    // Closest interval to a query; distance is 0 for an overlap, else how far apart the
+    // nearest ends are (1 for adjacent intervals, as bedtools closest -d counts)
+    struct Nearest {
+        uint32_t value;
+        int64_t distance;
+    };
+
+    void add(std::string_view chr, int64_t begin, int64_t end, uint32_t value) {
+        auto it = sequences_.find(chr);
+        if (it == sequences_.end()) it = sequences_.emplace(std::string(chr), Tree()).first;
+        it->second.intervals.push_back({begin, std::max(end, begin), 0, value});
+        it->second.built = false;
+        built_ = false;
+    }
+
+    // Sorts and augments every sequence that changed; queries need a built index
+    void build() {
+        for (auto& [chr, tree] : sequences_) {
+            if (!tree.built) tree.build();
+        }
+        built_ = true;
+    }
+
+    bool built() const { return built_; }
+
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (const auto& [chr, tree] : sequences_) n += tree.intervals.size();
+        return n;
+    }
+
+    // Calls fn(interval) for every interval overlapping [begin, end), in order of start.
+    // Empty intervals and queries count as covering their position.
+    template <typename Fn>
+    void overlaps(std::string_view chr, int64_t begin, int64_t end, Fn&& fn) const {
+        const Tree* tree = find(chr);
+        if (tree) tree->overlaps(begin, std::max(end, begin + 1), fn);
+    }
+
+    std::vector<uint32_t> overlaps(std::string_view chr, int64_t begin, int64_t end) const {
+        std::vector<uint32_t> values;
+        overlaps(chr, begin, end, [&values](const Interval& interval) { values.push_back(interval.value); });
+        return values;
+    }
+
+    // An overlapping interval (the first by start) if there is one, else the nearer of
+    // the closest intervals upstream and downstream (upstream on a tie)
+    std::optional<Nearest> nearest(std::string_view chr, int64_t begin, int64_t end) const {
+        const Tree* tree = find(chr);
+        if (!tree || tree->intervals.empty()) return std::nullopt;
+        end = std::max(end, begin + 1);
+        std::optional<Nearest> hit;
+        tree->overlaps(begin, end, [&hit](const Interval& interval) {
+            if (!hit) hit = Nearest{interval.value, 0};
+        });
+        if (hit) return hit;
+
+        // Nothing overlaps: every interval starting before end also ends before begin
+        const auto& intervals = tree->intervals;
+        const std::size_t next = tree->first_starting_at(end);
+        if (next > 0) {
+            const Interval& up = intervals[tree->max_end_before[next - 1]];
+            hit = Nearest{up.value, begin - covered_end(up) + 1};
+        }
+        if (next < intervals.size()) {
+            const int64_t distance = intervals[next].begin - end + 1;
+            if (!hit || distance < hit->distance) hit = Nearest{intervals[next].value, distance};
+        }
+        return hit;
+    }
+
+private:
+    struct Tree;
+
+public:
+    // -----------------------------
+    // Sweep: Answers a batch of queries sorted by (sequence, start) with one pass
+    // over the intervals, keeping those that can still overlap in an active list.
+    // A query on another sequence, or starting before the previous one, restarts
+    // the pass from a tree query, so any order gives the right result.
+    // -----------------------------
+    class Sweep {
+    public:
+        explicit Sweep(const IntervalIndex& index) : index_(&index) {}
+
+        // Calls fn(interval) for every interval overlapping [begin, end), in order of start
+        template <typename Fn>
+        void overlaps(std::string_view chr, int64_t begin, int64_t end, Fn&& fn) {
+            end = std::max(end, begin + 1);
+            if (chr != chr_ || !tree_) {
+                chr_.assign(chr);
+                tree_ = index_->find(chr);
+                if (!tree_) return;
+                restart(begin, end, fn);
+                return;
+            }
+            if (begin < last_begin_) {
+                restart(begin, end, fn);
+                return;
+            }
+            last_begin_ = begin;
+
+            // Take in what starts before the query ends, drop what ended before it starts
+            const auto& intervals = tree_->intervals;
+            while (next_ < intervals.size() && intervals[next_].begin < end) active_.push_back(next_++);
+            active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                         [&](std::size_t i) { return covered_end(intervals[i]) <= begin; }),
+                          active_.end());
+            for (std::size_t i : active_) {
+                if (intervals[i].begin < end) fn(intervals[i]);
+            }
+        }
+
+    private:
+        // The active list at a query is exactly its tree hits: the intervals starting
+        // before its end that have not ended before its start
+        template <typename Fn>
+        void restart(int64_t begin, int64_t end, Fn& fn) {
+            const auto& intervals = tree_->intervals;
+            active_.clear();
+            tree_->overlaps(begin, end, [&](const Interval& interval) {
+                active_.push_back(static_cast<std::size_t>(&interval - intervals.data()));
+                fn(interval);
+            });
+            next_ = tree_->first_starting_at(end);
+            last_begin_ = begin;
+        }
+
+        const IntervalIndex* index_;
+        std::string chr_;
+        const IntervalIndex::Tree* tree_ = nullptr;
+        std::size_t next_ = 0;              // first interval not taken in yet
+        std::vector<std::size_t> active_;   // taken in and not ended, in order of start
+        int64_t last_begin_ = 0;
+    };
+
+private:
+    // Empty intervals cover their position, like empty GTF features
+    static int64_t covered_end(const Interval& interval) { return std::max(interval.end, interval.begin + 1); }
+
+    struct Tree {
+        std::vector<Interval> intervals;      // sorted by start: the implicit tree
+        std::vector<uint32_t> max_end_before; // per index, the interval ending last among [0, index]
+        int root_level = -1;
+        bool built = false;
+
+        void build() {
+            std::stable_sort(intervals.begin(), intervals.end(),
+                             [](const Interval& a, const Interval& b) { return a.begin < b.begin; });
+            if (intervals.size() > std::numeric_limits<uint32_t>::max()) throw std::length_error("Too many intervals");
+            const int64_t n = static_cast<int64_t>(intervals.size());
+
+            max_end_before.resize(intervals.size());
+            for (int64_t i = 0; i < n; ++i) {
+                const bool longer = i == 0 || covered_end(intervals[i]) > covered_end(intervals[max_end_before[i - 1]]);
+                max_end_before[i] = longer ? static_cast<uint32_t>(i) : max_end_before[i - 1];
+            }
+
+            // Leaves (even indices) hold their own end; each level up takes the max of
+            // its node and both children. Nodes past n are stood in for by "last".
+            root_level = -1;
+            built = true;
+            if (n == 0) return;
+            int64_t last_i = 0;
+            int64_t last = 0;
+            for (int64_t i = 0; i < n; i += 2) {
+                last_i = i;
+                last = intervals[i].max_end = covered_end(intervals[i]);
+            }
+            int level = 1;
+            for (; (int64_t(1) << level) <= n; ++level) {
+                const int64_t x = int64_t(1) << (level - 1);
+                const int64_t first = (x << 1) - 1;
+                const int64_t step = x << 2;
+                for (int64_t i = first; i < n; i += step) {
+                    const int64_t left = intervals[i - x].max_end;
+                    const int64_t right = i + x < n ? intervals[i + x].max_end : last;
+                    intervals[i].max_end = std::max({covered_end(intervals[i]), left, right});
+                }
+                last_i = (last_i >> level & 1) ? last_i - x : last_i + x;
+                if (last_i < n && intervals[last_i].max_end > last) last = intervals[last_i].max_end;
+            }
+            root_level = level - 1;
+        }
+
+        // Index of the first interval starting at or after position
+        std::size_t first_starting_at(int64_t position) const {
+            return static_cast<std::size_t>(std::lower_bound(intervals.begin(), intervals.end(), position,
+                                                             [](const Interval& interval, int64_t p) {
+                                                                 return interval.begin < p;
+                                                             }) - intervals.begin());
+        }
+
+        // Top-down walk with an explicit stack; small subtrees are scanned linearly
+        template <typename Fn>
+        void overlaps(int64_t begin, int64_t end, Fn&& fn) const {
+            if (root_level < 0) return;
+            struct Node {
+                int64_t x;
+                int level;
+                bool left_done;
+            };
+            const int64_t n = static_cast<int64_t>(intervals.size());
+            Node stack[64];
+            int top = 0;
+            stack[top++] = {(int64_t(1) << root_level) - 1, root_level, false};
+            while (top > 0) {
+                const Node node = stack[--top];
+                if (node.level <= 3) {
+                    const int64_t first = node.x >> node.level << node.level;
+                    const int64_t last = std::min(n, first + (int64_t(1) << (node.level + 1)) - 1);
+                    for (int64_t i = first; i < last && intervals[i].begin < end; ++i) {
+                        if (begin < covered_end(intervals[i])) fn(intervals[i]);
+                    }
+                } else if (!node.left_done) {
+                    const int64_t left = node.x - (int64_t(1) << (node.level - 1)); // may lie past n
+                    stack[top++] = {node.x, node.level, true};
+                    if (left >= n || intervals[left].max_end > begin) stack[top++] = {left, node.level - 1, false};
+                } else if (node.x < n && intervals[node.x].begin < end) {
+                    if (begin < covered_end(intervals[node.x])) fn(intervals[node.x]);
+                    stack[top++] = {node.x + (int64_t(1) << (node.level - 1)), node.level - 1, false};
+                }
+            }
+        }
+    };
+
+    std::unordered_map<std::string, Tree, string_hash, std::equal_to<>> sequences_;
+    bool built_ = true;
+
+    const Tree* find(std::string_view chr) const {
+        if (!built_) throw std::logic_error("IntervalIndex queried before build()");
+        auto it = sequences_.find(chr);
+        return it == sequences_.end() ? nullptr : &it->second;
+    }
+};
+
+#endif // INTERVAL_INDEX_HPP
@@ -0,0 +1,148 @@
+#ifndef KEY_DICTIONARY_HPP
+#define KEY_DICTIONARY_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <initializer_list>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <cstdint>
+
+// -----------------------------
+// string_hash: Transparent hash so string-keyed containers can be probed with string_views
+// -----------------------------
+struct string_hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// -----------------------------
+// KeyDictionary: Process-wide mapping from attribute key to a small integer id
+// Ids are dense and never reused, so they can index plain vectors.
+// -----------------------------
+class KeyDictionary {
+public:
+    // Returns the id of key, adding it on first sight
+    uint32_t id(std::string_view key) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(key);
+            if (it != ids_.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(key);
+        if (it != ids_.end()) return it->second;
+        uint32_t next = static_cast<uint32_t>(names_.size());
+        names_.emplace_back(key);
+        ids_.emplace(names_.back(), next);
+        return next;
+    }
+
+    // Returns the id of key, or npos if it was never interned
+    uint32_t find(std::string_view key) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(key);
+        return it == ids_.end() ? npos : it->second;
+    }
+
+    const std::string& name(uint32_t id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return names_.at(id);
+    }
+
+    std::size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return names_.size();
+    }
+
+    static constexpr uint32_t npos = UINT32_MAX;
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::deque<std::string> names_; // deque keeps element addresses stable on growth
+    std::unordered_map<std::string, uint32_t, string_hash, std::equal_to<>> ids_;
+};
+
+inline KeyDictionary& key_dictionary() {
+    static KeyDictionary dictionary;
+    return dictionary;
+}
+
+// -----------------------------
+// KeyCache: Per-parser front for the global dictionary, avoids taking its lock per attribute
+// -----------------------------
+class KeyCache {
+public:
+    uint32_t id(std::string_view key) {
+        auto it = ids_.find(key);
+        if (it != ids_.end()) return it->second;
+        uint32_t id = key_dictionary().id(key);
+        ids_.emplace(std::string(key), id);
+        return id;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t, string_hash, std::equal_to<>> ids_;
+};
+
+// -----------------------------
+// AttributeList: Attributes of an owned line as (key id, value) pairs sorted by id
+// -----------------------------
+class AttributeList {
+public:
+    struct Entry {
+        uint32_t id;
+        std::string value;
+    };
+
+    AttributeList() {}
+
+    AttributeList(std::initializer_list<std::pair<std::string_view, std::string_view>> items) {
+        for (const auto& [key, value] : items) set(key, value);
+    }
+
+    // Inserts or replaces key; later values win, as with repeated GTF attributes
+    void set(uint32_t id, std::string_view value) {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), id,
+                                   [](const Entry& e, uint32_t v) { return e.id < v; });
+        if (it != entries_.end() && it->id == id) it->value = value;
+        else entries_.insert(it, Entry{id, std::string(value)});
+    }
+
+    void set(std::string_view key, std::string_view value) { set(key_dictionary().id(key), value); }
+
+    const std::string* find(uint32_t id) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), id,
+                                   [](const Entry& e, uint32_t v) { return e.id < v; });
+        return (it != entries_.end() && it->id == id) ? &it->value : nullptr;
+    }
+
+    const std::string* find(std::string_view key) const {
+        uint32_t id = key_dictionary().find(key);
+        return id == KeyDictionary::npos ? nullptr : find(id);
+    }
+
+    std::size_t count(std::string_view key) const { return find(key) ? 1 : 0; }
+
+    const std::string& at(std::string_view key) const {
+        const std::string* value = find(key);
+        if (!value) throw std::out_of_range("No attribute " + std::string(key));
+        return *value;
+    }
+
+    std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+    std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+    std::size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void reserve(std::size_t n) { entries_.reserve(n); }
+
+private:
+    std::vector<Entry> entries_;
+};
+
+#endif // KEY_DICTIONARY_HPP
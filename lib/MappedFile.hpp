@@ -0,0 +1,80 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// -----------------------------
+// MappedFile: Read-only memory mapping of a whole file
+// -----------------------------
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open file: " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat file: " + filename);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map file: " + filename);
+            }
+            data_ = static_cast<const char*>(addr);
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view data() const { return std::string_view(data_ ? data_ : "", size_); }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// -----------------------------
+// newline_aligned_chunks: Splits data into about n_chunks [begin, end) ranges
+// that each start at a line start and end just after a '\n' (or at the end)
+// -----------------------------
+inline std::vector<std::pair<std::size_t, std::size_t>> newline_aligned_chunks(std::string_view data, std::size_t n_chunks) {
+    std::vector<std::pair<std::size_t, std::size_t>> chunks;
+    if (n_chunks == 0) n_chunks = 1;
+    std::size_t target = data.size() / n_chunks + 1;
+    std::size_t begin = 0;
+    while (begin < data.size()) {
+        std::size_t end = begin + target;
+        if (end >= data.size()) {
+            end = data.size();
+        } else {
+            const void* nl = std::memchr(data.data() + end, '\n', data.size() - end);
+            end = nl ? static_cast<const char*>(nl) - data.data() + 1 : data.size();
+        }
+        chunks.emplace_back(begin, end);
+        begin = end;
+    }
+    return chunks;
+}
+
+#endif // MAPPED_FILE_HPP
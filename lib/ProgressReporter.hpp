@@ -0,0 +1,96 @@
+#ifndef PROGRESS_REPORTER_HPP
+#define PROGRESS_REPORTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// -----------------------------
+// ProgressReporter: Prints lines read, percent of the input done and an ETA
+// about once per second from a background thread. The reading loop only
+// stores to an atomic counter; nothing is formatted or flushed on the hot path.
+// -----------------------------
+class ProgressReporter {
+public:
+    using Print = std::function<void(const std::string&)>;
+    using Position = std::function<uint64_t()>;
+
+    // position() returns the bytes of input consumed so far and is called from the
+    // reporter thread; total is the input size (0 if unknown). An empty print
+    // (e.g. with --silent) disables reporting: no thread is started.
+    ProgressReporter(std::string label, uint64_t total, Position position, Print print,
+                     std::chrono::milliseconds interval = std::chrono::seconds(1))
+        : label_(std::move(label)), total_(total), position_(std::move(position)), print_(std::move(print)),
+          interval_(interval), start_(std::chrono::steady_clock::now()) {
+        if (print_) thread_ = std::thread([this] { run(); });
+    }
+
+    ~ProgressReporter() { stop(); }
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    // Counts lines; only the reading thread may call these (plain store, no locked add)
+    void line() { lines_.store(lines_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    void add_lines(uint64_t n) { lines_.store(lines_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    uint64_t lines() const { return lines_.load(std::memory_order_relaxed); }
+
+    // Stops the reporter thread and prints the final line count
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+        print_(label_ + " " + std::to_string(lines()) + " lines in " + format_seconds(elapsed()));
+    }
+
+private:
+    std::string label_;
+    uint64_t total_;
+    Position position_;
+    Print print_;
+    std::chrono::milliseconds interval_;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<uint64_t> lines_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    static std::string format_seconds(double s) {
+        const uint64_t t = static_cast<uint64_t>(s + 0.5);
+        if (t < 60) return std::to_string(t) + "s";
+        if (t < 3600) return std::to_string(t / 60) + "m" + std::to_string(t % 60) + "s";
+        return std::to_string(t / 3600) + "h" + std::to_string(t / 60 % 60) + "m";
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, interval_, [this] { return stopping_; })) {
+            std::string message = label_ + " " + std::to_string(lines()) + " lines";
+            const uint64_t done = position_ ? position_() : 0;
+            if (total_ > 0 && done > 0) {
+                const double fraction = std::min(1.0, static_cast<double>(done) / static_cast<double>(total_));
+                message += ", " + std::to_string(static_cast<int>(fraction * 100)) + "%";
+                message += " [ETA " + format_seconds(elapsed() * (1.0 - fraction) / fraction) + "]";
+            }
+            print_(message);
+        }
+    }
+};
+
+#endif // PROGRESS_REPORTER_HPP
@@ -0,0 +1,172 @@
+#ifndef REGION_SET_HPP
+#define REGION_SET_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
+
+#include "KeyDictionary.hpp"
+
+// -----------------------------
+// GenomicRegion: A 0-based, half-open range [begin, end) of one sequence
+// -----------------------------
+struct GenomicRegion {
+    static constexpr int64_t max_end = std::numeric_limits<int64_t>::max();
+
+    std::string chr;
+    int64_t begin = 0;
+    int64_t end = max_end;
+
+    // Reads "chr", "chr:start" or "chr:start-end" with 1-based inclusive positions,
+    // as samtools and tabix take them; thousands separators are allowed
+    static GenomicRegion parse(std::string_view text) {
+        GenomicRegion region;
+        const std::size_t colon = text.rfind(':');
+        if (colon == std::string_view::npos || !is_range(text.substr(colon + 1))) {
+            region.chr = text;
+        } else {
+            region.chr = text.substr(0, colon);
+            std::string range;
+            for (char c : text.substr(colon + 1)) {
+                if (c != ',') range += c;
+            }
+            const std::size_t dash = range.find('-');
+            const int64_t start = to_position(range.substr(0, dash), text);
+            region.begin = start - 1;
+            if (dash != std::string::npos && dash + 1 < range.size()) region.end = to_position(range.substr(dash + 1), text);
+            if (region.end <= region.begin) throw std::invalid_argument("Empty region: " + std::string(text));
+        }
+        if (region.chr.empty()) throw std::invalid_argument("Region without a sequence name: " + std::string(text));
+        return region;
+    }
+
+    // Reads the first three columns of a BED line (0-based start, end not included)
+    static GenomicRegion parse_bed(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        GenomicRegion region;
+        const std::size_t first = line.find('\t');
+        const std::size_t second = first == std::string_view::npos ? first : line.find('\t', first + 1);
+        if (second == std::string_view::npos) throw std::invalid_argument("BED line without start and end: " + std::string(line));
+        region.chr = line.substr(0, first);
+        const std::string_view start = line.substr(first + 1, second - first - 1);
+        const std::string_view end = line.substr(second + 1, line.find('\t', second + 1) - second - 1);
+        auto a = std::from_chars(start.data(), start.data() + start.size(), region.begin);
+        auto b = std::from_chars(end.data(), end.data() + end.size(), region.end);
+        if (a.ec != std::errc() || a.ptr != start.data() + start.size() || b.ec != std::errc()
+            || b.ptr != end.data() + end.size() || region.begin < 0 || region.chr.empty()) {
+            throw std::invalid_argument("Invalid BED line: " + std::string(line));
+        }
+        return region;
+    }
+
+    // Reads the position of a VCF record: CHROM, POS (1-based) and the span of REF
+    static GenomicRegion parse_vcf(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        std::string_view fields[4];
+        std::size_t pos = 0;
+        for (std::string_view& field : fields) {
+            if (pos > line.size()) throw std::invalid_argument("VCF line with fewer than 4 columns: " + std::string(line));
+            const std::size_t tab = std::min(line.find('\t', pos), line.size());
+            field = line.substr(pos, tab - pos);
+            pos = tab + 1;
+        }
+        GenomicRegion region;
+        region.chr = fields[0];
+        int64_t position = 0;
+        auto result = std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), position);
+        if (result.ec != std::errc() || result.ptr != fields[1].data() + fields[1].size() || position < 1 || region.chr.empty()) {
+            throw std::invalid_argument("Invalid VCF line: " + std::string(line));
+        }
+        region.begin = position - 1;
+        region.end = region.begin + static_cast<int64_t>(std::max<std::size_t>(1, fields[3].size()));
+        return region;
+    }
+
+private:
+    // Only digits, commas and dashes: a name such as "chrUn:KI270742v1" stays whole
+    static bool is_range(std::string_view s) {
+        return !s.empty() && std::isdigit(static_cast<unsigned char>(s[0]))
+            && s.find_first_not_of("0123456789,-") == std::string_view::npos;
+    }
+
+    static int64_t to_position(const std::string& s, std::string_view text) {
+        int64_t value = 0;
+        auto result = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (result.ec != std::errc() || result.ptr != s.data() + s.size() || value < 1) {
+            throw std::invalid_argument("Invalid region: " + std::string(text));
+        }
+        return value;
+    }
+};
+
+// -----------------------------
+// RegionSet: Ranges per sequence, merged where they overlap or touch, so that
+// overlap tests are one binary search and a region never yields a line twice
+// -----------------------------
+class RegionSet {
+public:
+    using Intervals = std::vector<std::pair<int64_t, int64_t>>; // sorted, disjoint [begin, end)
+
+    void add(const GenomicRegion& region) { add(region.chr, region.begin, region.end); }
+
+    void add(std::string_view chr, int64_t begin, int64_t end) {
+        if (end <= begin) return;
+        auto it = chromosomes_.find(chr);
+        if (it == chromosomes_.end()) {
+            it = chromosomes_.emplace(std::string(chr), Intervals()).first;
+            order_.push_back(it->first);
+        }
+        Intervals& intervals = it->second;
+        auto pos = std::lower_bound(intervals.begin(), intervals.end(), std::make_pair(begin, end));
+        pos = intervals.insert(pos, {begin, end});
+
+        // Fold the neighbours it overlaps or touches into the new interval
+        if (pos != intervals.begin() && std::prev(pos)->second >= pos->first) {
+            --pos;
+            pos->second = std::max(pos->second, std::next(pos)->second);
+            intervals.erase(std::next(pos));
+        }
+        while (std::next(pos) != intervals.end() && std::next(pos)->first <= pos->second) {
+            pos->second = std::max(pos->second, std::next(pos)->second);
+            intervals.erase(std::next(pos));
+        }
+    }
+
+    bool empty() const { return chromosomes_.empty(); }
+
+    // Sequences in the order they were first given
+    const std::vector<std::string>& chromosomes() const { return order_; }
+
+    // Intervals of chr, nullptr if the set has none there
+    const Intervals* find(std::string_view chr) const {
+        auto it = chromosomes_.find(chr);
+        return it == chromosomes_.end() ? nullptr : &it->second;
+    }
+
+    // True if [begin, end) overlaps one of the intervals
+    static bool overlaps(const Intervals& intervals, int64_t begin, int64_t end) {
+        auto it = std::upper_bound(intervals.begin(), intervals.end(), begin,
+                                   [](int64_t position, const std::pair<int64_t, int64_t>& interval) {
+                                       return position < interval.second;
+                                   });
+        return it != intervals.end() && it->first < std::max(end, begin + 1);
+    }
+
+    bool overlaps(std::string_view chr, int64_t begin, int64_t end) const {
+        const Intervals* intervals = find(chr);
+        return intervals && overlaps(*intervals, begin, end);
+    }
+
+private:
+    std::unordered_map<std::string, Intervals, string_hash, std::equal_to<>> chromosomes_;
+    std::vector<std::string> order_;
+};
+
+#endif // REGION_SET_HPP
@@ -0,0 +1,183 @@
+#ifndef RUN_STATS_HPP
+#define RUN_STATS_HPP
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <ctime>
+#include <sys/resource.h>
+
+namespace run_stats {
+
+// Heap allocations made by the process. Only the gtf2bed executable replaces
+// operator new to count them (and sets allocations_counted); elsewhere they read 0.
+inline std::atomic<uint64_t> heap_allocations{0};
+inline bool allocations_counted = false;
+
+inline double wall_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time of the whole process, so work done by pool threads is included
+inline double cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// Peak resident set size in bytes
+inline uint64_t peak_rss_bytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Linux reports KiB
+}
+
+} // namespace run_stats
+
+// -----------------------------
+// PhaseTime: Wall and CPU seconds spent in one phase
+// -----------------------------
+struct PhaseTime {
+    double wall = 0;
+    double cpu = 0;
+
+    void add(const PhaseTime& other) {
+        wall += other.wall;
+        cpu += other.cpu;
+    }
+};
+
+// -----------------------------
+// ReadCounters: Bytes handed to the line reader and the time spent waiting for
+// them (file reads plus decompression). Updated once per input buffer.
+// -----------------------------
+struct ReadCounters {
+    uint64_t bytes = 0;
+    PhaseTime time;
+};
+
+// -----------------------------
+// RunStats: Per-phase timings and counters of one conversion (--stats)
+// Clocks are only read at phase boundaries and once per input buffer, never
+// per line, so collecting them costs nothing measurable.
+// -----------------------------
+class RunStats {
+public:
+    enum Phase { Open, Decompress, Parse, Keys, Sort, Write, PhaseCount };
+
+    static const char* phase_name(Phase phase) {
+        static const char* names[] = {"open", "decompress", "parse", "keys", "sort", "write"};
+        return names[phase];
+    }
+
+    // Times a phase from construction until stop() or destruction. A timer nested
+    // in the timer of another phase passes it as from, so the time is not counted twice.
+    class Timer {
+    public:
+        Timer(RunStats& stats, Phase phase, Phase from = PhaseCount)
+            : stats_(&stats), phase_(phase), from_(from), wall_(run_stats::wall_seconds()), cpu_(run_stats::cpu_seconds()) {}
+        ~Timer() { stop(); }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        void stop() {
+            if (!stats_) return;
+            const PhaseTime spent{run_stats::wall_seconds() - wall_, run_stats::cpu_seconds() - cpu_};
+            stats_->phases[phase_].add(spent);
+            if (from_ != PhaseCount) stats_->phases[from_].add({-spent.wall, -spent.cpu});
+            stats_ = nullptr;
+        }
+
+    private:
+        RunStats* stats_;
+        Phase phase_;
+        Phase from_;
+        double wall_, cpu_;
+    };
+
+    std::array<PhaseTime, PhaseCount> phases;
+    std::string mode;             // cached, streaming, parallel or schema
+    unsigned int threads = 1;
+    uint64_t bytes_in = 0;        // input file size on disk
+    uint64_t text_bytes_in = 0;   // input after decompression
+    uint64_t bytes_out = 0;       // output file size on disk
+    uint64_t lines_kept = 0;
+    uint64_t lines_filtered = 0;
+
+    RunStats() : wall_(run_stats::wall_seconds()), cpu_(run_stats::cpu_seconds()) {}
+
+    // Moves the time spent reading input out of the phase that did the reading.
+    // A second pass over the same input (reread) adds its time but not its bytes.
+    void add_reads(const ReadCounters& reads, Phase from, bool reread = false) {
+        if (!reread) text_bytes_in += reads.bytes;
+        phases[Decompress].add(reads.time);
+        phases[from].wall -= reads.time.wall;
+        phases[from].cpu -= reads.time.cpu;
+    }
+
+    // Wall and CPU time since construction
+    PhaseTime total() const {
+        return {run_stats::wall_seconds() - wall_, run_stats::cpu_seconds() - cpu_};
+    }
+
+    // Human-readable report, one line per item
+    template <typename Print>
+    void report(Print&& print) const {
+        const PhaseTime all = total();
+        for (int p = 0; p < PhaseCount; ++p) {
+            print(pad(phase_name(static_cast<Phase>(p))) + seconds(phases[p].wall) + " s wall, "
+                  + seconds(phases[p].cpu) + " s cpu");
+        }
+        print(pad("total") + seconds(all.wall) + " s wall, " + seconds(all.cpu) + " s cpu");
+        print(pad("bytes in") + std::to_string(bytes_in) + " (" + std::to_string(text_bytes_in) + " uncompressed)");
+        print(pad("bytes out") + std::to_string(bytes_out));
+        print(pad("lines") + std::to_string(lines_kept) + " kept, " + std::to_string(lines_filtered) + " filtered, "
+              + std::to_string(static_cast<uint64_t>(lines_per_second(all))) + " lines/s");
+        print(pad("peak RSS") + std::to_string(run_stats::peak_rss_bytes() >> 20) + " MB");
+        print(pad("allocations") + (run_stats::allocations_counted ? std::to_string(run_stats::heap_allocations.load()) : "n/a"));
+    }
+
+    // Same content as report(), as a JSON object
+    void write_json(std::ostream& out) const {
+        const PhaseTime all = total();
+        out << std::setprecision(6) << std::fixed;
+        out << "{\n  \"mode\": \"" << mode << "\",\n  \"threads\": " << threads << ",\n  \"phases\": {";
+        for (int p = 0; p < PhaseCount; ++p) {
+            out << (p ? ",\n" : "\n") << "    \"" << phase_name(static_cast<Phase>(p)) << "\": {\"wall_seconds\": "
+                << phases[p].wall << ", \"cpu_seconds\": " << phases[p].cpu << "}";
+        }
+        out << "\n  },\n  \"total\": {\"wall_seconds\": " << all.wall << ", \"cpu_seconds\": " << all.cpu << "},\n";
+        out << "  \"bytes_in\": " << bytes_in << ",\n  \"uncompressed_bytes_in\": " << text_bytes_in
+            << ",\n  \"bytes_out\": " << bytes_out << ",\n";
+        out << "  \"lines_kept\": " << lines_kept << ",\n  \"lines_filtered\": " << lines_filtered
+            << ",\n  \"lines_per_second\": " << lines_per_second(all) << ",\n";
+        out << "  \"peak_rss_bytes\": " << run_stats::peak_rss_bytes() << ",\n  \"heap_allocations\": ";
+        if (run_stats::allocations_counted) out << run_stats::heap_allocations.load();
+        else out << "null";
+        out << "\n}\n";
+    }
+
+private:
+    double wall_, cpu_;
+
+    double lines_per_second(const PhaseTime& all) const {
+        return all.wall > 0 ? static_cast<double>(lines_kept + lines_filtered) / all.wall : 0.0;
+    }
+
+    static std::string pad(const std::string& label) {
+        return label + std::string(label.size() < 12 ? 12 - label.size() : 1, ' ');
+    }
+
+    static std::string seconds(double s) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3) << s;
+        return out.str();
+    }
+};
+
+#endif // RUN_STATS_HPP
@@ -0,0 +1,249 @@
+#ifndef SYNTHETIC_ANNOTATION_HPP
+#define SYNTHETIC_ANNOTATION_HPP
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "GTFIterator.hpp"
+
+// -----------------------------
+// SyntheticOptions: Shape of a generated annotation file
+// -----------------------------
+struct SyntheticOptions {
+    FileFormat format = FileFormat::GTF;
+    uint64_t target_bytes = 1 << 20;   // generation stops at the first gene boundary past this size
+    unsigned int chromosomes = 22;     // genes are spread evenly over chr1..chrN, sorted by position
+    unsigned int attributes = 8;       // distinct optional attribute keys on top of the GENCODE core keys
+    double escape_percent = 1.0;       // share of GFF/GFF3 lines with a %XX-encoded Note value
+    uint64_t seed = 1;
+};
+
+// -----------------------------
+// SyntheticAnnotation: Deterministic GENCODE-like GTF/GFF/GFF3 writer
+// Genes carry transcripts with exons, CDS, UTRs and start/stop codons. The
+// same options always produce the same bytes: the generator has its own
+// PRNG (splitmix64) instead of the implementation-defined std distributions.
+// -----------------------------
+class SyntheticAnnotation {
+public:
+    explicit SyntheticAnnotation(SyntheticOptions options) : options_(options), state_(options.seed) {
+        options_.chromosomes = std::max(1u, options_.chromosomes);
+        static const char* known[] = {"havana_gene", "transcript_support_level", "tag", "hgnc_id",
+                                      "havana_transcript", "ccdsid", "protein_id", "ont"};
+        for (unsigned int i = 0; i < options_.attributes; ++i) {
+            extra_keys_.push_back(i < std::size(known) ? known[i] : "attr_" + std::to_string(i));
+        }
+    }
+
+    // Writes the whole file to out; returns the number of lines written
+    uint64_t write(std::ostream& out) {
+        out_ = &out;
+        if (options_.format == FileFormat::GFF3) append("##gff-version 3\n");
+        else if (options_.format == FileFormat::GFF) append("#format: gff2\n");
+        lines_ = 0;
+        while (bytes_ + buffer_.size() < options_.target_bytes) write_gene();
+        flush();
+        return lines_;
+    }
+
+    uint64_t lines() const { return lines_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    SyntheticOptions options_;
+    uint64_t state_;
+    std::vector<std::string> extra_keys_;
+    std::ostream* out_ = nullptr;
+    std::string buffer_;
+    uint64_t bytes_ = 0;
+    uint64_t lines_ = 0;
+    uint64_t gene_ = 0;
+    unsigned int chromosome_ = 0;
+    int64_t cursor_ = 10000; // next free position on the current chromosome
+
+    // Fields shared by the lines of one gene
+    std::string seqname_, gene_id_, gene_name_, gene_type_, transcript_id_, transcript_name_, transcript_type_;
+    char strand_ = '+';
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    uint64_t below(uint64_t n) { return next() % n; }
+    bool chance(double percent) { return below(1000000) < percent * 10000; }
+
+    void append(std::string_view s) { buffer_.append(s.data(), s.size()); }
+    void append(int64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr - digits);
+    }
+
+    void flush() {
+        out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        bytes_ += buffer_.size();
+        buffer_.clear();
+    }
+
+    static std::string padded(const char* prefix, uint64_t number) {
+        std::string digits = std::to_string(number);
+        return prefix + std::string(digits.size() < 11 ? 11 - digits.size() : 0, '0') + digits;
+    }
+
+    void write_gene() {
+        // Move on to the next chromosome in proportion to the output written
+        uint64_t written = bytes_ + buffer_.size();
+        unsigned int chromosome = static_cast<unsigned int>(
+            std::min<uint64_t>(options_.chromosomes - 1, written * options_.chromosomes / std::max<uint64_t>(1, options_.target_bytes)));
+        if (chromosome != chromosome_ || seqname_.empty()) {
+            chromosome_ = chromosome;
+            seqname_ = "chr" + std::to_string(chromosome_ + 1);
+            cursor_ = 10000;
+        }
+
+        static const char* gene_types[] = {"protein_coding", "protein_coding", "protein_coding", "lncRNA",
+                                           "processed_pseudogene", "misc_RNA", "snRNA", "TEC"};
+        gene_++;
+        gene_id_ = padded("ENSG", gene_) + "." + std::to_string(1 + below(20));
+        gene_name_ = "GENE" + std::to_string(gene_);
+        gene_type_ = gene_types[below(std::size(gene_types))];
+        strand_ = below(2) ? '+' : '-';
+
+        int64_t gene_start = cursor_ + static_cast<int64_t>(below(20000));
+        int64_t gene_end = gene_start + 1000 + static_cast<int64_t>(below(80000));
+        cursor_ = gene_end;
+
+        line("gene", gene_start, gene_end, '.', Level::Gene, 0);
+
+        uint64_t transcripts = 1 + below(5);
+        for (uint64_t t = 0; t < transcripts; ++t) {
+            transcript_id_ = padded("ENST", gene_ * 10 + t) + "." + std::to_string(1 + below(10));
+            transcript_name_ = gene_name_ + "-" + std::to_string(201 + t);
+            transcript_type_ = t == 0 ? gene_type_ : gene_types[below(std::size(gene_types))];
+            write_transcript(gene_start, gene_end);
+        }
+        if (buffer_.size() >= (1 << 20)) flush(); // hand over 1 MB blocks
+    }
+
+    void write_transcript(int64_t gene_start, int64_t gene_end) {
+        // Exons cut out of the gene span, left to right
+        uint64_t exons = 1 + below(12);
+        int64_t span = gene_end - gene_start;
+        int64_t step = std::max<int64_t>(2, span / static_cast<int64_t>(exons));
+        std::vector<std::pair<int64_t, int64_t>> exon_ranges;
+        for (uint64_t e = 0; e < exons; ++e) {
+            int64_t start = gene_start + static_cast<int64_t>(e) * step;
+            int64_t end = std::min(gene_end, start + 50 + static_cast<int64_t>(below(std::max<int64_t>(1, step - 50))));
+            exon_ranges.emplace_back(start, std::max(start, end));
+        }
+        line("transcript", exon_ranges.front().first, exon_ranges.back().second, '.', Level::Transcript, 0);
+
+        const bool coding = transcript_type_ == "protein_coding";
+        for (uint64_t e = 0; e < exons; ++e) {
+            auto [start, end] = exon_ranges[e];
+            int exon_number = static_cast<int>(strand_ == '+' ? e + 1 : exons - e);
+            line("exon", start, end, '.', Level::Exon, exon_number);
+            if (!coding) continue;
+            // Coding exons: the first and last carry the UTRs and codons
+            int64_t cds_start = start, cds_end = end;
+            if (e == 0 && end - start > 20) {
+                cds_start = start + 10;
+                line(strand_ == '+' ? "five_prime_utr" : "three_prime_utr", start, cds_start - 1, '.', Level::Exon, exon_number);
+                line(strand_ == '+' ? "start_codon" : "stop_codon", cds_start, cds_start + 2, '0', Level::Exon, exon_number);
+            }
+            if (e + 1 == exons && cds_end - cds_start > 20) {
+                cds_end = end - 10;
+                line(strand_ == '+' ? "stop_codon" : "start_codon", cds_end - 2, cds_end, '0', Level::Exon, exon_number);
+                line(strand_ == '+' ? "three_prime_utr" : "five_prime_utr", cds_end + 1, end, '.', Level::Exon, exon_number);
+            }
+            line("CDS", cds_start, cds_end, static_cast<char>('0' + below(3)), Level::Exon, exon_number);
+        }
+    }
+
+    enum class Level { Gene, Transcript, Exon };
+
+    void line(const char* feature, int64_t start, int64_t end, char frame, Level level, int exon_number) {
+        append(seqname_);
+        append(options_.format == FileFormat::GTF ? "\tENSEMBL\t" : "\tHAVANA\t");
+        append(feature);
+        append("\t");
+        append(start);
+        append("\t");
+        append(end);
+        append("\t.\t");
+        buffer_ += strand_;
+        buffer_ += '\t';
+        buffer_ += frame;
+        buffer_ += '\t';
+
+        bool first = true;
+        auto attribute = [&](std::string_view key, std::string_view value) {
+            switch (options_.format) {
+                case FileFormat::GTF:
+                    if (!first) buffer_ += ' ';
+                    append(key);
+                    append(" \"");
+                    append(value);
+                    append("\";");
+                    break;
+                case FileFormat::GFF:
+                case FileFormat::GFF3:
+                    if (!first) buffer_ += ';';
+                    append(key);
+                    buffer_ += '=';
+                    append(value);
+                    break;
+            }
+            first = false;
+        };
+
+        if (options_.format == FileFormat::GFF3) {
+            if (level == Level::Gene) {
+                attribute("ID", gene_id_);
+            } else if (level == Level::Transcript) {
+                attribute("ID", transcript_id_);
+                attribute("Parent", gene_id_);
+            } else {
+                attribute("ID", std::string(feature) + ":" + transcript_id_ + ":" + std::to_string(exon_number));
+                attribute("Parent", transcript_id_);
+            }
+        }
+        attribute("gene_id", gene_id_);
+        if (level != Level::Gene) attribute("transcript_id", transcript_id_);
+        attribute("gene_type", gene_type_);
+        attribute("gene_name", gene_name_);
+        if (level != Level::Gene) {
+            attribute("transcript_type", transcript_type_);
+            attribute("transcript_name", transcript_name_);
+        }
+        if (level == Level::Exon) {
+            attribute("exon_number", std::to_string(exon_number));
+            attribute("exon_id", padded("ENSE", gene_ * 100 + static_cast<uint64_t>(exon_number)) + ".1");
+        }
+        attribute("level", std::to_string(1 + below(3)));
+
+        // Optional keys: each present on about half of the lines, from a small value pool
+        for (const std::string& key : extra_keys_) {
+            if (below(2)) attribute(key, key + "_" + std::to_string(below(50)));
+        }
+
+        // Free text that GFF/GFF3 must percent-encode
+        if (chance(options_.escape_percent)) {
+            if (options_.format == FileFormat::GTF) attribute("Note", "putative protein, isoform " + std::to_string(below(9)));
+            else attribute("Note", "putative%20protein%2C%20isoform%20" + std::to_string(below(9)) + "%3B%20predicted");
+        }
+
+        buffer_ += '\n';
+        lines_++;
+    }
+};
+
+#endif // SYNTHETIC_ANNOTATION_HPP
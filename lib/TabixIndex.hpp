@@ -0,0 +1,326 @@
+#ifndef TABIX_INDEX_HPP
+#define TABIX_INDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+#include "BGZF.hpp"
+#include "BedSorter.hpp"
+
+// -----------------------------
+// TabixLayout: Columns of the indexed lines, as the index header records them
+// -----------------------------
+struct TabixLayout {
+    static constexpr uint32_t ucsc_format = 0x10000; // flag: 0-based half-open like BED
+
+    uint32_t format = ucsc_format;  // 0 is generic: 1-based, both ends included
+    uint32_t seq = 1;               // 1-based column numbers
+    uint32_t begin = 2;
+    uint32_t end = 3;
+    char meta = '#';                // lines starting with it are not indexed
+
+    static TabixLayout bed() { return {}; }
+    static TabixLayout gff() { return {0, 1, 4, 5, '#'}; } // tabix -p gff, for GTF/GFF/GFF3
+
+    bool zero_based() const { return format & ucsc_format; }
+};
+
+// -----------------------------
+// TabixIndex: Builds the tabix (.tbi) or CSI index of BED output (or of other
+// lines, given their TabixLayout) while it is written. The BGZF writer hands over every uncompressed byte; rows are located
+// by their uncompressed offsets and turned into virtual offsets when the index
+// is saved, from the block offsets the writer recorded. Nothing is read back.
+// Binning starts at the 5 levels of tabix and gains a level whenever a row ends
+// past the covered range, which turns the index into CSI (chromosomes > 512 Mb).
+// -----------------------------
+class TabixIndex {
+public:
+    static constexpr int min_shift = 14;   // 16 kb linear windows and smallest bins
+    static constexpr int tbi_depth = 5;    // covers 2^29 bp
+
+    explicit TabixIndex(TabixLayout layout = TabixLayout::bed())
+        : layout_(layout), last_column_(std::max({layout.seq, layout.begin, layout.end})) {}
+    TabixIndex(const TabixIndex&) = delete;
+    TabixIndex& operator=(const TabixIndex&) = delete;
+
+    // Indexes everything written through writer from now on
+    void attach(std::shared_ptr<BGZFWriter> writer) {
+        if (!writer) throw std::invalid_argument("Only BGZF (.gz/.bgz) output can be indexed");
+        writer_ = std::move(writer);
+        writer_->set_tap([this](const char* s, std::size_t n) { add(s, n); });
+    }
+
+    // Takes uncompressed output in order; meta lines (starting with '#') are not indexed
+    void add(const char* s, std::size_t n) {
+        const char* end = s + n;
+        while (s < end) {
+            const char* nl = static_cast<const char*>(std::memchr(s, '\n', static_cast<std::size_t>(end - s)));
+            const std::size_t take = static_cast<std::size_t>((nl ? nl : end) - s);
+            if (!head_complete_) keep_head(s, std::min(take, max_head - std::min(max_head, head_.size())));
+            offset_ += take;
+            s += take;
+            if (!nl) break;
+            offset_++;
+            s++;
+            end_line();
+        }
+    }
+
+    // False if rows were not grouped by chromosome and sorted by start
+    bool sorted() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    // CSI is needed once a row ends beyond what tabix can address
+    bool csi() const { return depth_ > tbi_depth; }
+    std::size_t references() const { return references_.size(); }
+
+    // Writes bed_file.tbi (bed_file.csi if csi()) and returns its name
+    std::string save(const std::string& bed_file) const {
+        if (!writer_) throw std::logic_error("No BGZF output was attached to the index");
+        if (!sorted()) throw std::runtime_error(error_);
+        const std::string path = bed_file + (csi() ? ".csi" : ".tbi");
+
+        std::string out;
+        auto put32 = [&out](uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i))); };
+        auto put64 = [&out](uint64_t v) { for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(v >> (8 * i))); };
+        auto voffset = [this](uint64_t position) { return writer_->virtual_offset(position); };
+
+        std::string names;
+        for (const Reference& ref : references_) names += ref.name + '\0';
+        auto put_conf = [&] {
+            put32(layout_.format);
+            put32(layout_.seq);
+            put32(layout_.begin);
+            put32(layout_.end);
+            put32(static_cast<uint32_t>(layout_.meta));
+            put32(0);
+            put32(static_cast<uint32_t>(names.size()));
+            out += names;
+        };
+
+        if (csi()) {
+            out += std::string("CSI\1", 4);
+            put32(min_shift);
+            put32(static_cast<uint32_t>(depth_));
+            put32(static_cast<uint32_t>(7 * 4 + names.size()));
+            put_conf();
+        } else {
+            out += std::string("TBI\1", 4);
+            put32(static_cast<uint32_t>(references_.size()));
+            put_conf();
+        }
+        if (csi()) put32(static_cast<uint32_t>(references_.size()));
+
+        for (const Reference& ref : references_) {
+            // Linear index: windows without rows take the offset of the previous one
+            std::vector<uint64_t> linear(ref.linear.size());
+            uint64_t previous = 0;
+            for (std::size_t w = 0; w < linear.size(); ++w) {
+                if (ref.linear[w] != unset) previous = voffset(ref.linear[w]);
+                linear[w] = previous;
+            }
+
+            put32(static_cast<uint32_t>(ref.bins.size() + 1));
+            for (const auto& [bin, chunks] : ref.bins) {
+                put32(bin);
+                if (csi()) put64(bin_loffset(bin, linear));
+                put32(static_cast<uint32_t>(chunks.size()));
+                for (const auto& [begin, end] : chunks) {
+                    put64(voffset(begin));
+                    put64(voffset(end));
+                }
+            }
+            // Pseudo-bin: offsets spanned by the chromosome and its row count
+            put32(meta_bin());
+            if (csi()) put64(0);
+            put32(2);
+            put64(voffset(ref.begin));
+            put64(voffset(ref.end));
+            put64(ref.rows);
+            put64(0);
+
+            if (!csi()) {
+                put32(static_cast<uint32_t>(linear.size()));
+                for (uint64_t v : linear) put64(v);
+            }
+        }
+        put64(0); // rows without coordinates
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) throw std::runtime_error("Cannot create index file: " + path);
+        {
+            BGZFWriter compressed(file, 1);
+            compressed.write(out.data(), out.size());
+            compressed.close();
+        }
+        if (!file) throw std::runtime_error("Cannot write index file: " + path);
+        return path;
+    }
+
+    // Bin of the 0-based, half-open range [begin, end) with levels of binning (htslib hts_reg2bin)
+    static uint32_t region_bin(int64_t begin, int64_t end, int levels) {
+        int shift = min_shift;
+        --end;
+        for (int level = levels; level > 0; --level, shift += 3) {
+            if (begin >> shift == end >> shift) return level_first_bin(level) + static_cast<uint32_t>(begin >> shift);
+        }
+        return 0;
+    }
+
+    // First bin of a level: (8^level - 1) / 7
+    static uint32_t level_first_bin(int level) { return static_cast<uint32_t>(((uint64_t(1) << (3 * level)) - 1) / 7); }
+
+private:
+    static constexpr std::size_t max_head = 4096;      // longest start of a line read up to its end column
+    static constexpr uint64_t unset = std::numeric_limits<uint64_t>::max();
+    static constexpr int max_depth = 9;                // bins still fit 32 bits: 2^41 bp
+
+    struct Reference {
+        std::string name;
+        std::map<uint32_t, std::vector<std::pair<uint64_t, uint64_t>>> bins; // uncompressed [begin, end) chunks
+        std::vector<uint64_t> linear;                                        // first row offset per window
+        uint64_t begin = 0, end = 0, rows = 0;
+    };
+
+    TabixLayout layout_;
+    uint32_t last_column_;     // the line is read up to the end of this column
+    std::shared_ptr<BGZFWriter> writer_;
+    std::vector<Reference> references_;
+    std::set<std::string, std::less<>> seen_;
+    int depth_ = tbi_depth;
+    std::string head_;         // current line up to its last indexed column
+    int head_tabs_ = 0;
+    bool head_complete_ = false;
+    uint64_t offset_ = 0;      // uncompressed bytes seen
+    uint64_t line_start_ = 0;
+    uint64_t lines_ = 0;
+    int64_t last_start_ = 0;
+    std::string error_;
+
+    uint32_t meta_bin() const { return level_first_bin(depth_ + 1) + 1; }
+
+    // Offset of the first row that can overlap bin: the linear index at the bin's first window
+    uint64_t bin_loffset(uint32_t bin, const std::vector<uint64_t>& linear) const {
+        int level = 0;
+        while (level < depth_ && bin >= level_first_bin(level + 1)) level++;
+        const uint64_t window = static_cast<uint64_t>(bin - level_first_bin(level)) << (3 * (depth_ - level));
+        if (linear.empty()) return 0;
+        return linear[std::min<uint64_t>(window, linear.size() - 1)];
+    }
+
+    void end_line() {
+        const uint64_t begin = line_start_, end = offset_;
+        line_start_ = offset_;
+        lines_++;
+        const bool indexed = !head_.empty() && head_[0] != layout_.meta && error_.empty();
+        if (indexed) add_row(key_of(head_), begin, end);
+        head_.clear();
+        head_tabs_ = 0;
+        head_complete_ = false;
+    }
+
+    // Keeps the start of the line up to the end of its last indexed column
+    void keep_head(const char* s, std::size_t n) {
+        const char* p = s;
+        const char* end = s + n;
+        while (p < end) {
+            p = static_cast<const char*>(std::memchr(p, '\t', static_cast<std::size_t>(end - p)));
+            if (!p) break;
+            if (++head_tabs_ == static_cast<int>(last_column_)) {
+                head_complete_ = true;
+                end = p;
+                break;
+            }
+            p++;
+        }
+        head_.append(s, static_cast<std::size_t>(end - s));
+    }
+
+    // Sequence and 0-based, half-open range of a line
+    BedKey key_of(std::string_view head) const {
+        if (layout_.seq == 1 && layout_.begin == 2 && layout_.end == 3 && layout_.zero_based()) return BedKey::of(head);
+        BedKey key;
+        uint32_t column = 1;
+        std::size_t pos = 0;
+        while (column <= last_column_ && pos <= head.size()) {
+            std::size_t tab = std::min(head.find('\t', pos), head.size());
+            std::string_view field = head.substr(pos, tab - pos);
+            if (column == layout_.seq) key.chr = field;
+            if (column == layout_.begin) std::from_chars(field.data(), field.data() + field.size(), key.start);
+            if (column == layout_.end) std::from_chars(field.data(), field.data() + field.size(), key.end);
+            pos = tab + 1;
+            column++;
+        }
+        if (!layout_.zero_based()) key.start--;
+        return key;
+    }
+
+    void add_row(const BedKey& key, uint64_t begin, uint64_t end) {
+        if (references_.empty() || references_.back().name != key.chr) {
+            if (seen_.count(key.chr)) {
+                error_ = "rows of " + std::string(key.chr) + " are not contiguous (line " + std::to_string(lines_) + ")";
+                return;
+            }
+            seen_.emplace(key.chr);
+            references_.push_back(Reference{std::string(key.chr), {}, {}, begin, end, 0});
+            last_start_ = 0;
+        }
+        if (key.start < last_start_) {
+            error_ = "rows of " + std::string(key.chr) + " are not sorted by start (line " + std::to_string(lines_) + ")";
+            return;
+        }
+        last_start_ = key.start;
+        const int64_t start = std::max<int64_t>(0, key.start);
+        push(references_.back(), start, std::max(key.end, start + 1), begin, end);
+    }
+
+    void push(Reference& ref, int64_t start, int64_t end, uint64_t begin, uint64_t stop) {
+        while (end > (int64_t(1) << (min_shift + 3 * depth_))) add_level();
+
+        // Rows of one bin that are next to each other, or in the same BGZF block, share a chunk
+        auto& chunks = ref.bins[region_bin(start, end, depth_)];
+        if (!chunks.empty() && (chunks.back().second == begin
+                                || chunks.back().second / bgzf::block_data_size == begin / bgzf::block_data_size)) {
+            chunks.back().second = stop;
+        } else {
+            chunks.emplace_back(begin, stop);
+        }
+
+        const std::size_t first = static_cast<std::size_t>(start >> min_shift);
+        const std::size_t last = static_cast<std::size_t>((end - 1) >> min_shift);
+        if (ref.linear.size() <= last) ref.linear.resize(last + 1, unset);
+        for (std::size_t w = first; w <= last; ++w) {
+            if (ref.linear[w] == unset) ref.linear[w] = begin;
+        }
+        ref.end = stop;
+        ref.rows++;
+    }
+
+    // Puts a new root on top: every bin keeps its offset one level further down
+    void add_level() {
+        if (depth_ == max_depth) throw std::runtime_error("Position too large to index");
+        for (Reference& ref : references_) {
+            std::map<uint32_t, std::vector<std::pair<uint64_t, uint64_t>>> bins;
+            for (auto& [bin, chunks] : ref.bins) {
+                int level = 0;
+                while (level < depth_ && bin >= level_first_bin(level + 1)) level++;
+                bins[level_first_bin(level + 1) + (bin - level_first_bin(level))] = std::move(chunks);
+            }
+            ref.bins = std::move(bins);
+        }
+        depth_++;
+    }
+};
+
+#endif // TABIX_INDEX_HPP
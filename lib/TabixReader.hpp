@@ -0,0 +1,235 @@
+#ifndef TABIX_READER_HPP
+#define TABIX_READER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include "BGZF.hpp"
+#include "RegionSet.hpp"
+#include "TabixIndex.hpp"
+
+// -----------------------------
+// TabixReader: Loads a tabix (.tbi) or CSI index and lists the BGZF chunks
+// that can hold lines overlapping a region: the chunks of every bin the region
+// touches (htslib's reg2bins), minus those ending before the first line that
+// can reach the region's start (linear index for tabix, bin loffsets for CSI).
+// The chunks are a superset; lines still have to be checked against the region.
+// -----------------------------
+class TabixReader {
+public:
+    using Chunk = BGZFChunkReader::Chunk;
+
+    explicit TabixReader(const std::string& index_file) {
+        if (!std::filesystem::exists(index_file)) throw std::runtime_error("Cannot open index file: " + index_file);
+        try {
+            load(inflate(index_file));
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Invalid index file " + index_file + ": " + e.what());
+        }
+    }
+
+    // The index next to data_file: data_file.tbi or data_file.csi, empty if there is none
+    static std::string find_for(const std::string& data_file) {
+        for (const char* suffix : {".tbi", ".csi"}) {
+            if (std::filesystem::exists(data_file + suffix)) return data_file + suffix;
+        }
+        return {};
+    }
+
+    bool csi() const { return csi_; }
+    const TabixLayout& layout() const { return layout_; }
+    const std::vector<std::string>& names() const { return names_; }
+    bool has(std::string_view chr) const { return ids_.find(chr) != ids_.end(); }
+
+    // Chunks of lines that may overlap [begin, end) of chr (0-based), merged, in file order
+    std::vector<Chunk> chunks(std::string_view chr, int64_t begin, int64_t end) const {
+        std::vector<Chunk> found;
+        collect(chr, begin, end, found);
+        return merged(std::move(found));
+    }
+
+    // Chunks of all regions, each part of the file listed once
+    std::vector<Chunk> chunks(const RegionSet& regions) const {
+        std::vector<Chunk> found;
+        for (const std::string& chr : regions.chromosomes()) {
+            for (const auto& [begin, end] : *regions.find(chr)) collect(chr, begin, end, found);
+        }
+        return merged(std::move(found));
+    }
+
+private:
+    struct Bin {
+        uint64_t loffset = 0;          // CSI: first line that can overlap the bin
+        std::vector<Chunk> chunks;
+    };
+    struct Reference {
+        std::unordered_map<uint32_t, Bin> bins;
+        std::vector<uint64_t> linear;  // tabix: first line per 2^min_shift window
+    };
+
+    bool csi_ = false;
+    int min_shift_ = TabixIndex::min_shift;
+    int depth_ = TabixIndex::tbi_depth;
+    TabixLayout layout_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, std::size_t, string_hash, std::equal_to<>> ids_;
+    std::vector<Reference> references_;
+
+    static std::string inflate(const std::string& index_file) {
+        BGZFReader reader(index_file, 1);
+        std::string data;
+        char buffer[1 << 16];
+        std::streamsize n;
+        while ((n = reader.read(buffer, sizeof(buffer))) > 0) data.append(buffer, static_cast<std::size_t>(n));
+        return data;
+    }
+
+    void load(const std::string& data) {
+        std::size_t p = 0;
+        auto take = [&](std::size_t n) {
+            if (data.size() - p < n) throw std::runtime_error("truncated");
+            const char* at = data.data() + p;
+            p += n;
+            return at;
+        };
+        auto u32 = [&] { return bgzf::read_u32(reinterpret_cast<const unsigned char*>(take(4))); };
+        auto u64 = [&] {
+            const uint64_t low = u32();
+            return low | (static_cast<uint64_t>(u32()) << 32);
+        };
+
+        // Sequence names and columns; in a CSI index they are its auxiliary data
+        auto read_conf = [&] {
+            layout_.format = u32();
+            layout_.seq = u32();
+            layout_.begin = u32();
+            layout_.end = u32();
+            layout_.meta = static_cast<char>(u32());
+            u32(); // lines to skip
+            const uint32_t length = u32();
+            std::string_view names(take(length), length);
+            while (!names.empty()) {
+                const std::size_t nul = std::min(names.find('\0'), names.size());
+                names_.emplace_back(names.substr(0, nul));
+                names.remove_prefix(std::min(nul + 1, names.size()));
+            }
+        };
+
+        const std::string_view magic(take(4), 4);
+        uint32_t references = 0;
+        if (magic == std::string_view("TBI\1", 4)) {
+            references = u32();
+            read_conf();
+        } else if (magic == std::string_view("CSI\1", 4)) {
+            csi_ = true;
+            min_shift_ = static_cast<int>(u32());
+            depth_ = static_cast<int>(u32());
+            const uint32_t aux = u32();
+            if (aux < 28) throw std::runtime_error("CSI index without sequence names");
+            const std::size_t conf_end = p + aux;
+            read_conf();
+            p = conf_end;
+            references = u32();
+        } else {
+            throw std::runtime_error("not a tabix or CSI index");
+        }
+        if (names_.size() != references) throw std::runtime_error("sequence names do not match the references");
+
+        const uint32_t meta = TabixIndex::level_first_bin(depth_ + 1) + 1; // pseudo-bin with counts, not chunks
+        references_.resize(references);
+        for (Reference& ref : references_) {
+            const uint32_t bins = u32();
+            for (uint32_t b = 0; b < bins; ++b) {
+                const uint32_t id = u32();
+                Bin bin;
+                if (csi_) bin.loffset = u64();
+                const uint32_t chunks = u32();
+                for (uint32_t c = 0; c < chunks; ++c) {
+                    const uint64_t begin = u64();
+                    bin.chunks.emplace_back(begin, u64());
+                }
+                if (id != meta) ref.bins[id] = std::move(bin);
+            }
+            if (!csi_) {
+                ref.linear.resize(u32());
+                for (uint64_t& offset : ref.linear) offset = u64();
+            }
+        }
+        for (std::size_t i = 0; i < names_.size(); ++i) ids_.emplace(names_[i], i);
+    }
+
+    void collect(std::string_view chr, int64_t begin, int64_t end, std::vector<Chunk>& found) const {
+        auto id = ids_.find(chr);
+        if (id == ids_.end()) return;
+        const Reference& ref = references_[id->second];
+        begin = std::max<int64_t>(0, begin);
+        end = std::min(end, int64_t(1) << (min_shift_ + 3 * depth_));
+        if (begin >= end) return;
+
+        // Bins overlapping the range, one span of ids per level
+        std::vector<std::pair<uint64_t, uint64_t>> spans;
+        uint64_t count = 0;
+        for (int level = 0, shift = min_shift_ + 3 * depth_; level <= depth_; ++level, shift -= 3) {
+            const uint64_t first = TabixIndex::level_first_bin(level);
+            spans.emplace_back(first + (begin >> shift), first + ((end - 1) >> shift));
+            count += spans.back().second - spans.back().first + 1;
+        }
+
+        const uint64_t min_offset = first_offset(ref, begin);
+        auto take = [&](const Bin& bin) {
+            for (const Chunk& chunk : bin.chunks) {
+                if (chunk.second > min_offset) found.push_back(chunk);
+            }
+        };
+        if (count <= ref.bins.size()) {
+            for (const auto& [first, last] : spans) {
+                for (uint64_t b = first; b <= last; ++b) {
+                    auto bin = ref.bins.find(static_cast<uint32_t>(b));
+                    if (bin != ref.bins.end()) take(bin->second);
+                }
+            }
+        } else {
+            // Large ranges (a whole chromosome) span more bins than the reference has
+            for (const auto& [id, bin] : ref.bins) {
+                for (const auto& [first, last] : spans) {
+                    if (id >= first && id <= last) take(bin);
+                }
+            }
+        }
+    }
+
+    // Lines before this offset end before begin
+    uint64_t first_offset(const Reference& ref, int64_t begin) const {
+        if (!csi_) {
+            if (ref.linear.empty()) return 0;
+            return ref.linear[std::min<std::size_t>(static_cast<std::size_t>(begin >> min_shift_), ref.linear.size() - 1)];
+        }
+        // The smallest bin holding begin that has lines, walking up to the root
+        uint32_t bin = TabixIndex::level_first_bin(depth_) + static_cast<uint32_t>(begin >> min_shift_);
+        while (bin > 0) {
+            auto found = ref.bins.find(bin);
+            if (found != ref.bins.end()) return found->second.loffset;
+            bin = (bin - 1) >> 3;
+        }
+        return 0;
+    }
+
+    static std::vector<Chunk> merged(std::vector<Chunk> chunks) {
+        std::sort(chunks.begin(), chunks.end());
+        std::vector<Chunk> out;
+        for (const Chunk& chunk : chunks) {
+            if (!out.empty() && chunk.first <= out.back().second) out.back().second = std::max(out.back().second, chunk.second);
+            else out.push_back(chunk);
+        }
+        return out;
+    }
+};
+
+#endif // TABIX_READER_HPP
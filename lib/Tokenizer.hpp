@@ -0,0 +1,148 @@
+#ifndef TOKENIZER_HPP
+#define TOKENIZER_HPP
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GTF2BED_X86 1
+#endif
+
+// -----------------------------
+// SeparatorSet: Up to four separator bytes searched for in one pass
+// -----------------------------
+struct SeparatorSet {
+    char c[4];
+
+    constexpr SeparatorSet(char a) : c{a, a, a, a} {}
+    constexpr SeparatorSet(char a, char b) : c{a, b, b, b} {}
+    constexpr SeparatorSet(char a, char b, char d) : c{a, b, d, d} {}
+    constexpr SeparatorSet(char a, char b, char d, char e) : c{a, b, d, e} {}
+
+    bool contains(char x) const { return x == c[0] || x == c[1] || x == c[2] || x == c[3]; }
+};
+
+// -----------------------------
+// Separator scanning: appends the offsets of separator bytes in s to out, in
+// order, stopping once out holds max offsets. The SIMD versions build a 64-bit
+// mask of matches per 64-byte block; all versions give identical results.
+// -----------------------------
+namespace tokenizer {
+
+enum class Level { Scalar, SSE2, AVX2 };
+
+using ScanFn = void (*)(std::string_view, SeparatorSet, std::vector<uint32_t>&, std::size_t);
+
+// Appends the offsets of the set bits of mask (bit i = byte base + i); false once max is reached
+inline bool emit_mask(uint64_t mask, std::size_t base, std::vector<uint32_t>& out, std::size_t max) {
+    while (mask) {
+        if (out.size() >= max) return false;
+        out.push_back(static_cast<uint32_t>(base + __builtin_ctzll(mask)));
+        mask &= mask - 1;
+    }
+    return out.size() < max;
+}
+
+inline void scan_scalar_from(std::string_view s, std::size_t i, SeparatorSet set,
+                             std::vector<uint32_t>& out, std::size_t max) {
+    for (; i < s.size() && out.size() < max; ++i) {
+        if (set.contains(s[i])) out.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+inline void scan_scalar(std::string_view s, SeparatorSet set, std::vector<uint32_t>& out, std::size_t max) {
+    scan_scalar_from(s, 0, set, out, max);
+}
+
+#ifdef GTF2BED_X86
+
+__attribute__((target("sse2")))
+inline uint64_t mask16_sse2(const char* p, __m128i a, __m128i b, __m128i c, __m128i d) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, c), _mm_cmpeq_epi8(v, d)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(m));
+}
+
+__attribute__((target("sse2")))
+inline void scan_sse2(std::string_view s, SeparatorSet set, std::vector<uint32_t>& out, std::size_t max) {
+    const __m128i a = _mm_set1_epi8(set.c[0]), b = _mm_set1_epi8(set.c[1]);
+    const __m128i c = _mm_set1_epi8(set.c[2]), d = _mm_set1_epi8(set.c[3]);
+    std::size_t i = 0;
+    if (out.size() >= max) return;
+    for (; i + 64 <= s.size(); i += 64) {
+        const char* p = s.data() + i;
+        uint64_t mask = mask16_sse2(p, a, b, c, d)
+                      | mask16_sse2(p + 16, a, b, c, d) << 16
+                      | mask16_sse2(p + 32, a, b, c, d) << 32
+                      | mask16_sse2(p + 48, a, b, c, d) << 48;
+        if (!emit_mask(mask, i, out, max)) return;
+    }
+    scan_scalar_from(s, i, set, out, max);
+}
+
+__attribute__((target("avx2")))
+inline uint64_t mask32_avx2(const char* p, __m256i a, __m256i b, __m256i c, __m256i d) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, b)),
+                                _mm256_or_si256(_mm256_cmpeq_epi8(v, c), _mm256_cmpeq_epi8(v, d)));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+}
+
+__attribute__((target("avx2")))
+inline void scan_avx2(std::string_view s, SeparatorSet set, std::vector<uint32_t>& out, std::size_t max) {
+    const __m256i a = _mm256_set1_epi8(set.c[0]), b = _mm256_set1_epi8(set.c[1]);
+    const __m256i c = _mm256_set1_epi8(set.c[2]), d = _mm256_set1_epi8(set.c[3]);
+    std::size_t i = 0;
+    if (out.size() >= max) return;
+    for (; i + 64 <= s.size(); i += 64) {
+        const char* p = s.data() + i;
+        uint64_t mask = mask32_avx2(p, a, b, c, d) | mask32_avx2(p + 32, a, b, c, d) << 32;
+        if (!emit_mask(mask, i, out, max)) return;
+    }
+    scan_scalar_from(s, i, set, out, max);
+}
+
+#endif // GTF2BED_X86
+
+// Best level the running CPU supports
+inline Level detect_level() {
+#ifdef GTF2BED_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+#endif
+    return Level::Scalar;
+}
+
+inline ScanFn scan_function(Level level) {
+#ifdef GTF2BED_X86
+    switch (level) {
+        case Level::AVX2: return scan_avx2;
+        case Level::SSE2: return scan_sse2;
+        case Level::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return scan_scalar;
+}
+
+// Chosen once at startup so one binary runs on every x86-64 node
+inline ScanFn active_scan() {
+    static const ScanFn fn = scan_function(detect_level());
+    return fn;
+}
+
+} // namespace tokenizer
+
+// Offsets of up to max separators of set in s, appended to out
+inline void find_separators(std::string_view s, SeparatorSet set, std::vector<uint32_t>& out,
+                            std::size_t max = SIZE_MAX) {
+    tokenizer::active_scan()(s, set, out, max);
+}
+
+#endif // TOKENIZER_HPP
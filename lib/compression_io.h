@@ -26,6 +26,8 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
 
+#include "BGZF.hpp"
+
 using namespace std;
 
 class input_file : public boost::iostreams::filtering_istream {
@@ -64,11 +66,18 @@ class output_file : public boost::iostreams::filtering_ostream {
 protected:
 	ofstream file_descriptor;
 
+	// .gz and .bgz output is written as BGZF: valid gzip that tabix can index
+	static bool is_bgzf_name(const string& filename) {
+		string extension = filename.substr(filename.find_last_of(".") + 1);
+		return extension == "gz" || extension == "bgz";
+	}
+
 public:
-	output_file(string filename) {
-		if (filename.substr(filename.find_last_of(".") + 1) == "gz") {
+	output_file(string filename, unsigned int threads = 1) {
+		if (is_bgzf_name(filename)) {
 			file_descriptor.open(filename.c_str(), ios::out | ios::binary);
-			push(boost::iostreams::gzip_compressor());
+			if (!file_descriptor.fail()) push(bgzf_sink(file_descriptor, threads));
+			return;
 		} else if (filename.substr(filename.find_last_of(".") + 1) == "bz2") {
 			file_descriptor.open(filename.c_str(), ios::out | ios::binary);
 			push(boost::iostreams::bzip2_compressor());
@@ -78,10 +87,11 @@ public:
 
 	output_file(){}
 
-	void open(string filename){
-		if (filename.substr(filename.find_last_of(".") + 1) == "gz") {
+	void open(string filename, unsigned int threads = 1){
+		if (is_bgzf_name(filename)) {
 			file_descriptor.open(filename.c_str(), ios::out | ios::binary);
-			push(boost::iostreams::gzip_compressor());
+			if (!file_descriptor.fail()) push(bgzf_sink(file_descriptor, threads));
+			return;
 		} else if (filename.substr(filename.find_last_of(".") + 1) == "bz2") {
 			file_descriptor.open(filename.c_str(), ios::out | ios::binary);
 			push(boost::iostreams::bzip2_compressor());
@@ -89,10 +99,11 @@ public:
 		if (!file_descriptor.fail()) push(file_descriptor);
 	}
 
-	void append(string filename){
-		if (filename.substr(filename.find_last_of(".") + 1) == "gz") {
+	void append(string filename, unsigned int threads = 1){
+		if (is_bgzf_name(filename)) {
 			file_descriptor.open(filename.c_str(), ios::app | ios::binary);
-			push(boost::iostreams::gzip_compressor());
+			if (!file_descriptor.fail()) push(bgzf_sink(file_descriptor, threads));
+			return;
 		} else if (filename.substr(filename.find_last_of(".") + 1) == "bz2") {
 			file_descriptor.open(filename.c_str(), ios::app | ios::binary);
 			push(boost::iostreams::bzip2_compressor());
@@ -104,6 +115,13 @@ public:
 		close();
 	}
 
+	// Writer behind .gz/.bgz output, null for other outputs
+	shared_ptr<BGZFWriter> bgzf_writer() {
+		if (empty()) return nullptr;
+		bgzf_sink* sink = component<bgzf_sink>(0);
+		return sink ? sink->writer() : nullptr;
+	}
+
 	bool fail() {
 		return file_descriptor.fail();
 	}
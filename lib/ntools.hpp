@@ -5,15 +5,19 @@
 //INCLUDE STANDARD TEMPLATE LIBRARY USEFULL STUFFS (STL)
 #include <vector>
 #include <list>
+#include <deque>
 #include <set>
 #include <map>
 #include <unordered_set>
 #include <unordered_map>
 #include <algorithm>
+#include <numeric>
+#include <functional>
 #include <cmath>
 #include <string>
 #include <exception>
 #include <iostream>
+#include <filesystem>
 
 //INCLUDE BOOST USEFULL STUFFS (BOOST)
 #include <boost/program_options.hpp>
@@ -22,7 +26,22 @@
 
 //INCLUDE BASE STUFF 
 #include "compression_io.h"
+#include "KeyDictionary.hpp"
 #include "GTFIterator.hpp"
+#include "AnnotationStore.hpp"
+#include "AnnotationSnapshot.hpp"
+#include "ThreadPool.hpp"
+#include "MappedFile.hpp"
+#include "BedWriter.hpp"
+#include "BedSorter.hpp"
+#include "TabixIndex.hpp"
+#include "TabixReader.hpp"
+#include "RegionSet.hpp"
+#include "IntervalIndex.hpp"
+#include "ByteSize.hpp"
+#include "Tokenizer.hpp"
+#include "RunStats.hpp"
+#include "ProgressReporter.hpp"
 #include <verbose.hpp>
 
 
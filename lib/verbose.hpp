@@ -40,6 +40,10 @@ public:
 		verbose_on_screen = false;
 	}
 
+	bool silent() const {
+		return !verbose_on_screen;
+	}
+
 	void print(string s) {
 		if (verbose_on_screen) cout << s << endl;
 		if (verbose_on_log) log << s << endl;
@@ -32,14 +32,44 @@ void gtf2BedMain(std::vector<std::string>& argv)
     // Define input/output file options
     boost::program_options::options_description opt_files("\x1B[35mI/O\33[0m");
     opt_files.add_options()
-        ("input,i", boost::program_options::value<std::string>(), "Input GTF/GFF/GFF3 file")
-        ("output,o", boost::program_options::value<std::string>(), "Output file to write bed file")
+        ("input,i", boost::program_options::value<std::vector<std::string>>()->multitoken()->composing(),
+         "Input GTF/GFF/GFF3 file. Several files are converted as one batch")
+        ("output,o", boost::program_options::value<std::string>(), "Output file to write bed file (output directory for several inputs)")
         ("format,f", boost::program_options::value<std::string>(), "file format [GFF/GTF/GFF3]")
+        ("manifest", boost::program_options::value<std::string>(),
+         "File of \"input output [format]\" rows, converted as one batch on the --threads threads")
         ("feature-type,t",
          boost::program_options::value<std::vector<std::string>>()->multitoken()->composing()->default_value({"all"}, "all"), 
-         "What feature types to include. \033[1mMake sure the feature type specified exists in your input file!!\033[0m");
+         "What feature types to include. \033[1mMake sure the feature type specified exists in your input file!!\033[0m")
+        ("streaming", "Read the input twice (keys first, then rows) instead of caching it in memory")
+        ("columns", boost::program_options::value<std::vector<std::string>>()->multitoken()->composing(),
+         "Fixed attribute columns (e.g. gene_id,transcript_id). Converts in a single pass")
+        ("schema-file", boost::program_options::value<std::string>(), "File listing the attribute columns, one per line")
+        ("attributes", boost::program_options::value<std::vector<std::string>>()->multitoken()->composing(),
+         "Only parse and write these attributes (e.g. gene_id,gene_name). Others are never decoded")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(1),
+         "Number of threads used to parse uncompressed input or inflate BGZF input; shared by the files of a batch")
+        ("cache", boost::program_options::value<std::string>(),
+         "Binary snapshot (.g2b) of the parsed input: mapped instead of parsing while the input is unchanged, rebuilt otherwise")
+        ("sort", "Sort the output by chromosome, start and end")
+        ("max-memory", boost::program_options::value<std::string>(),
+         "Memory for --sort rows (e.g. 4G) before sorted runs are spilled to disk, or for all files of a batch [default: half of RAM]")
+        ("temp-dir", boost::program_options::value<std::string>(), "Directory for --sort run files [default: system temp directory]")
+        ("index", "Write a tabix (.tbi) or CSI index next to bgzipped (.gz/.bgz) output. Implies --sort")
+        ("region", boost::program_options::value<std::vector<std::string>>()->multitoken()->composing(),
+         "Only convert lines overlapping these regions (chr, chr:start or chr:start-end, 1-based). Bgzipped input with a .tbi/.csi index is read through the index")
+        ("regions-bed", boost::program_options::value<std::string>(), "Only convert lines overlapping the regions of this BED file")
+        ("annotate", boost::program_options::value<std::string>(),
+         "Instead of converting, write the features overlapping each position of this BED or VCF file")
+        ("nearest", "With --annotate, report the nearest feature and its distance for positions that overlap none");
+
+    // Define instrumentation options
+    boost::program_options::options_description opt_stats("\x1B[35mStatistics\33[0m");
+    opt_stats.add_options()
+        ("stats", "Report time per phase, bytes in/out, lines/s, peak memory and heap allocations")
+        ("stats-json", boost::program_options::value<std::string>(), "Also write the --stats report as JSON to this file");
         
-    P.option_descriptions.add(opt_basic).add(opt_files);
+    P.option_descriptions.add(opt_basic).add(opt_files).add(opt_stats);
 
     //-------------------
     // 2. PARSE OPTIONS
@@ -65,15 +95,16 @@ void gtf2BedMain(std::vector<std::string>& argv)
     // 4. COMMON CHECKS
     //-----------------
     bool hasErrors = false;
-    if (!P.options.count("input")) {
+    const bool manifest = P.options.count("manifest") > 0;
+    if (!P.options.count("input") && !manifest) {
         std::cout << "Input file needs to be specified with --input" << std::endl;
         hasErrors = true;
     }
-    if (!P.options.count("output")) {
+    if (!P.options.count("output") && !manifest) {
         std::cout << "Output needs to be specified with --output [file.out]" << std::endl;
         hasErrors = true;
     }
-    if (!P.options.count("format")) {
+    if (!P.options.count("format") && !manifest) {
         std::cout << "You need to specify the file format." << std::endl;
         hasErrors = true;
     }
@@ -89,25 +120,358 @@ void gtf2BedMain(std::vector<std::string>& argv)
         P.featureTypes.insert(ft_vector.begin(), ft_vector.end());
     }
 
-    P.outFile = P.options["output"].as<std::string>();
-    P.input_file = P.options["input"].as<std::string>();
+    // Several inputs or a manifest make a batch; -o then names the output directory
+    const std::string defaultFormat = P.options.count("format") ? P.options["format"].as<std::string>() : "";
+    std::vector<BatchFile> batch;
+    if (manifest) batch = readManifest(P.options["manifest"].as<std::string>(), defaultFormat);
+    const std::vector<std::string> inputs = P.options.count("input") ? P.options["input"].as<std::vector<std::string>>() : std::vector<std::string>();
+    if (inputs.size() > 1 || (manifest && !inputs.empty())) {
+        if (!P.options.count("output")) vrb.error("Name the output directory of the --input files with --output");
+        if (defaultFormat.empty()) vrb.error("You need to specify the file format of the --input files with --format");
+        const std::filesystem::path directory = P.options["output"].as<std::string>();
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (!std::filesystem::is_directory(directory)) vrb.error("Cannot create output directory [" + directory.string() + "]");
+        for (const std::string& input : inputs) {
+            BatchFile file;
+            file.input = input;
+            file.output = (directory / batch_output_name(input, P.options.count("index") > 0)).string();
+            file.format = parse_format(defaultFormat);
+            batch.push_back(std::move(file));
+        }
+    }
+    const bool batchMode = !batch.empty();
+    if (manifest && !batchMode) vrb.error("The manifest [" + P.options["manifest"].as<std::string>() + "] lists no files");
+    if (batchMode) {
+        if (P.options.count("cache")) vrb.error("--cache takes a single input: it cannot be used for a batch");
+        if (P.options.count("annotate")) vrb.error("--annotate takes a single input: it cannot be used for a batch");
+        std::set<std::string> outputs;
+        for (const BatchFile& file : batch) {
+            if (!std::filesystem::exists(file.input)) vrb.error("Cannot open input file [" + file.input + "]");
+            const std::filesystem::path directory = std::filesystem::path(file.output).parent_path();
+            std::error_code ec;
+            if (!directory.empty()) std::filesystem::create_directories(directory, ec);
+            if (!outputs.insert(std::filesystem::weakly_canonical(file.output).string()).second) {
+                vrb.error("Two files of the batch are written to [" + file.output + "]");
+            }
+            if (P.options.count("index") && !boost::ends_with(file.output, ".gz") && !boost::ends_with(file.output, ".bgz")) {
+                vrb.error("--index needs bgzipped output: name the output file [" + file.output + "] .gz or .bgz");
+            }
+        }
+    } else {
+        P.outFile = P.options["output"].as<std::string>();
+        P.input_file = inputs.front();
+    }
+    P.threads = std::max(1u, P.options["threads"].as<unsigned int>());
+    P.streaming = P.options.count("streaming") > 0;
+    if (P.threads > 1 && !batchMode) {
+        Compression compression = detect_compression(P.input_file);
+        if (compression == Compression::BGZF) {
+            vrb.bullet("BGZF input: inflating blocks with " + std::to_string(P.threads) + " threads");
+        } else if (compression != Compression::NONE) {
+            vrb.warning("Plain gzip/bzip2 input is decompressed on a single thread. Recompress with bgzip to use --threads");
+        }
+    }
     
-    // Determine file format
-    FileFormat format_;
-    if (P.options["format"].as<std::string>() == "gtf") format_ = FileFormat::GTF;
-    if (P.options["format"].as<std::string>() == "gff") format_ = FileFormat::GFF;
-    if (P.options["format"].as<std::string>() == "gff3") format_ = FileFormat::GFF3;
+    // Determine file format (each batch file has its own)
+    FileFormat format_ = batchMode ? FileFormat::GTF : parse_format(defaultFormat);
+
+    // Fixed column schema, from the command line and/or a file
+    std::vector<std::string> schemaKeys;
+    if (P.options.count("columns")) {
+        for (const std::string& item : P.options["columns"].as<std::vector<std::string>>()) {
+            split_columns(item, schemaKeys);
+        }
+    }
+    if (P.options.count("schema-file")) {
+        input_file fds(P.options["schema-file"].as<std::string>());
+        if (fds.fail()) vrb.error("Cannot open schema file [" + P.options["schema-file"].as<std::string>() + "]");
+        std::string buffer;
+        while (std::getline(fds, buffer)) {
+            if (!buffer.empty() && buffer[0] == '#') continue;
+            split_columns(buffer, schemaKeys);
+        }
+    }
+    if ((P.options.count("columns") || P.options.count("schema-file")) && schemaKeys.empty()) {
+        vrb.error("The column schema given with --columns/--schema-file is empty");
+    }
+
+    // Attribute projection: the parser skips every other key
+    if (P.options.count("attributes")) {
+        for (const std::string& item : P.options["attributes"].as<std::vector<std::string>>()) {
+            split_columns(item, P.attributeProjection);
+        }
+        if (P.attributeProjection.empty()) vrb.error("No attribute given with --attributes");
+        if (!schemaKeys.empty()) vrb.warning("--attributes is ignored: the --columns/--schema-file schema already selects the attributes");
+    }
+
+    // Annotation keeps the features in memory and writes rows in position order
+    const bool annotating = P.options.count("annotate") > 0;
+    if (annotating) {
+        if (P.options.count("index") || P.options.count("sort")) vrb.error("--annotate writes rows in the order of its positions: it cannot be combined with --sort/--index");
+        if (P.options.count("streaming")) vrb.warning("--streaming is ignored: --annotate keeps the features in memory");
+        if (!schemaKeys.empty()) P.attributeProjection = schemaKeys; // only the schema columns are parsed
+    } else if (P.options.count("nearest")) {
+        vrb.error("--nearest needs --annotate");
+    }
+
+    // The index is built from the BGZF block offsets while the sorted output is written
+    if (P.options.count("index")) {
+        if (!batchMode && !boost::ends_with(P.outFile, ".gz") && !boost::ends_with(P.outFile, ".bgz")) {
+            vrb.error("--index needs bgzipped output: name the output file .gz or .bgz");
+        }
+        P.indexOutput = true;
+    }
+
+    // Sorted output: in memory within --max-memory, through run files on disk beyond it.
+    // A batch shares --max-memory between the files it converts at once.
+    if (P.options.count("sort") || P.indexOutput || batchMode) {
+        if (P.options.count("max-memory")) {
+            P.maxMemory = parse_size(P.options["max-memory"].as<std::string>());
+            if (P.maxMemory == 0) vrb.error("Invalid --max-memory [" + P.options["max-memory"].as<std::string>() + "]");
+        } else {
+            P.maxMemory = std::max<uint64_t>(physical_memory_bytes() / 2, 256 << 20);
+        }
+    }
+    if (P.options.count("sort") || P.indexOutput) {
+        P.sortOutput = true;
+        P.tempDir = P.options.count("temp-dir") ? P.options["temp-dir"].as<std::string>()
+                                                : std::filesystem::temp_directory_path().string();
+        if (!std::filesystem::is_directory(P.tempDir)) vrb.error("Temporary directory [" + P.tempDir + "] does not exist");
+    }
+
+    // Region query: lines elsewhere are skipped, or never read when the input is indexed
+    if (P.options.count("region")) {
+        for (const std::string& item : P.options["region"].as<std::vector<std::string>>()) {
+            try {
+                P.regions.add(GenomicRegion::parse(item));
+            } catch (const std::invalid_argument& e) {
+                vrb.error(e.what());
+            }
+        }
+    }
+    if (P.options.count("regions-bed")) {
+        input_file fdr(P.options["regions-bed"].as<std::string>());
+        if (fdr.fail()) vrb.error("Cannot open regions file [" + P.options["regions-bed"].as<std::string>() + "]");
+        std::string buffer;
+        while (std::getline(fdr, buffer)) {
+            if (buffer.empty() || buffer[0] == '#' || boost::starts_with(buffer, "track") || boost::starts_with(buffer, "browser")) continue;
+            try {
+                P.regions.add(GenomicRegion::parse_bed(buffer));
+            } catch (const std::invalid_argument& e) {
+                vrb.error(e.what());
+            }
+        }
+    }
+    if ((P.options.count("region") || P.options.count("regions-bed")) && P.regions.empty()) {
+        vrb.error("The regions given with --region/--regions-bed are empty");
+    }
+    if (!P.regions.empty() && !P.options.count("cache") && !batchMode) P.openInputIndex(P.input_file);
 
     //-------------
     // RUN ANALYSIS
     //-------------
-    P.cacheGTFFile(P.input_file, format_);
+    if (batchMode) {
+        const double start = run_stats::wall_seconds();
+        convertBatch(P, batch, schemaKeys);
+        reportBatch(batch, run_stats::wall_seconds() - start,
+                    P.options.count("stats-json") ? P.options["stats-json"].as<std::string>() : std::string());
+        return;
+    }
+    runConversion(P, format_, schemaKeys);
 
-    // Sort attribute keys for consistent output column ordering
-    std::vector<std::string> sortedKeys(P.attribute_keys.begin(), P.attribute_keys.end());
-    std::sort(sortedKeys.begin(), sortedKeys.end());
+    //-------------
+    // STATISTICS
+    //-------------
+    if (P.options.count("stats") || P.options.count("stats-json")) {
+        std::error_code ec;
+        P.stats.bytes_in = std::filesystem::file_size(P.input_file, ec);
+        P.stats.bytes_out = std::filesystem::file_size(P.outFile, ec);
+        if (ec) P.stats.bytes_out = 0; // e.g. /dev/null
+    }
+    if (P.options.count("stats")) {
+        vrb.title("Statistics");
+        P.stats.report([](const std::string& line) { vrb.bullet(line); });
+    }
+    if (P.options.count("stats-json")) {
+        std::ofstream json(P.options["stats-json"].as<std::string>());
+        if (!json) vrb.error("Cannot open statistics file [" + P.options["stats-json"].as<std::string>() + "]");
+        P.stats.write_json(json);
+    }
+}
+
+/**
+ * @brief Run the conversion path the options select for one input
+ */
+void runConversion(GTF2Bed& P, FileFormat format_, std::vector<std::string>& schemaKeys)
+{
+    const bool annotating = P.options.count("annotate") > 0;
+    P.stats.threads = P.threads;
+    if (P.options.count("cache")) {
+        // Parsed once into a snapshot; later runs map it and only filter and write
+        P.stats.mode = "snapshot";
+        const std::string snapshot_file = P.options["cache"].as<std::string>();
+        if (P.snapshotIsFresh(snapshot_file, P.input_file, format_)) {
+            vrb.bullet("Using snapshot [" + snapshot_file + "]");
+        } else {
+            P.buildSnapshot(P.input_file, format_, snapshot_file);
+        }
+        P.loadSnapshot(snapshot_file);
+
+        RunStats::Timer sorting(P.stats, RunStats::Sort);
+        std::vector<std::string> sortedKeys = schemaKeys.empty() ? P.sortedAttributeKeys() : schemaKeys;
+        sorting.stop();
+
+        if (annotating) P.annotatePositions(P.options["annotate"].as<std::string>(), sortedKeys, P.options.count("nearest"));
+        else P.writeToBed(sortedKeys);
+    } else if (annotating) {
+        // Features cached and indexed by position; the positions stream past them once
+        P.stats.mode = "annotate";
+        P.cacheGTFFile(P.input_file, format_);
+        RunStats::Timer sorting(P.stats, RunStats::Sort);
+        std::vector<std::string> sortedKeys = schemaKeys.empty() ? P.sortedAttributeKeys() : schemaKeys;
+        sorting.stop();
+        P.annotatePositions(P.options["annotate"].as<std::string>(), sortedKeys, P.options.count("nearest"));
+    } else if (!schemaKeys.empty()) {
+        // Header is known up front: one pass, rows written as they are parsed
+        P.stats.mode = "schema";
+        P.convertWithSchema(P.input_file, format_, schemaKeys);
+    } else if (P.streaming || P.useParallel(P.input_file) || !P.cacheFitsMemory(P.input_file)) {
+        // Two passes over the input: memory only holds the attribute key union.
+        // The parallel path always works this way, it never caches the file.
+        P.stats.mode = P.useParallel(P.input_file) ? "parallel" : "streaming";
+        if (!P.streaming && !P.useParallel(P.input_file) && P.reportSteps) {
+            vrb.bullet("Input does not fit --max-memory: converting in two passes with an external sort");
+        }
+        P.scanGTFFile(P.input_file, format_);
+        RunStats::Timer sorting(P.stats, RunStats::Sort);
+        std::vector<std::string> sortedKeys = P.sortedAttributeKeys();
+        sorting.stop();
+        P.streamToBed(P.input_file, format_, sortedKeys);
+    } else {
+        P.stats.mode = "cached";
+        P.cacheGTFFile(P.input_file, format_);
+
+        // Sort attribute keys for consistent output column ordering
+        RunStats::Timer sorting(P.stats, RunStats::Sort);
+        std::vector<std::string> sortedKeys = P.sortedAttributeKeys();
+        sorting.stop();
+
+        P.writeToBed(sortedKeys);
+    }
+
+    if (P.indexOutput) P.writeIndex();
+}
+
+//--------------------//
+//  BED ROW WRITING   //
+//--------------------//
+
+// Attribute lookup by interned key id for streamed views and cached records
+static const std::string_view* find_attribute(const GTFLineView& line, uint32_t key)
+{
+    return line.find(key);
+}
+
+static const std::string_view* find_attribute(const GTFRecord& line, uint32_t key)
+{
+    return line.find(key);
+}
+
+static std::optional<std::string_view> find_attribute(const SnapshotRecord& line, uint32_t key)
+{
+    return line.find(key);
+}
+
+// Interns the output columns once so rows are written without hashing
+static std::vector<uint32_t> intern_keys(const std::vector<std::string>& keys)
+{
+    std::vector<uint32_t> ids;
+    ids.reserve(keys.size());
+    for (const std::string& key : keys) ids.push_back(key_dictionary().id(key));
+    return ids;
+}
+
+// Keys the parser has to materialise to write the given columns: gene_id is always
+// needed for the BED name. An empty list means no projection, every key is parsed.
+static std::vector<std::string> with_gene_id(std::vector<std::string> keys)
+{
+    if (!keys.empty() && std::find(keys.begin(), keys.end(), "gene_id") == keys.end()) keys.push_back("gene_id");
+    return keys;
+}
+
+// Progress lines go through vrb once per second from a background thread; none with --silent
+// or when disabled (the files of a batch)
+static ProgressReporter::Print progress_printer(bool enabled = true)
+{
+    if (vrb.silent() || !enabled) return nullptr;
+    return [](const std::string& message) { vrb.bullet(message); };
+}
+
+// Size of the input on disk, the 100% mark of progress reports (0 if unknown)
+static uint64_t input_size(const std::string& input_file)
+{
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(input_file, ec);
+    return ec ? 0 : size;
+}
+
+// Memory the columnar cache of a file takes: about half its text, which is some ten
+// times the size of compressed input
+static uint64_t cache_estimate(const std::string& input_file)
+{
+    const uint64_t size = input_size(input_file);
+    return is_compressed_file(input_file) ? size * 5 : size / 2;
+}
+
+// Lines the (first pass) filter kept and rejected, for --stats
+static void count_lines(RunStats& stats, const FeatureFilter& filter)
+{
+    stats.lines_kept += filter.kept();
+    stats.lines_filtered += filter.rejected();
+}
+
+// Reorders rows of table by (chr, start, end); rows with equal keys keep their order
+template <typename Table>
+static void sort_rows(std::vector<uint32_t>& rows, const Table& table, unsigned int threads)
+{
+    struct Keyed {
+        BedKey key;
+        uint32_t row;
+    };
+    std::vector<Keyed> keyed;
+    keyed.reserve(rows.size());
+    for (uint32_t row : rows) {
+        const auto line = table[row];
+        keyed.push_back({{line.seqname, line.start, line.end}, row});
+    }
+    parallel_stable_sort(keyed.begin(), keyed.end(), [](const Keyed& a, const Keyed& b) { return a.key < b.key; }, threads);
+    for (std::size_t i = 0; i < rows.size(); ++i) rows[i] = keyed[i].row;
+}
+
+// Adds the keys of line to keys; seen (indexed by key id) skips the string set for known keys
+template <typename Set>
+static void collect_keys(const GTFLineView& line, std::vector<char>& seen, Set& keys)
+{
+    for (const GTFAttribute& attr : line.attributes) {
+        if (attr.id >= seen.size()) seen.resize(attr.id + 1, 0);
+        if (!seen[attr.id]) {
+            seen[attr.id] = 1;
+            keys.emplace(attr.key);
+        }
+    }
+}
 
-    P.writeToBed(sortedKeys);
+/**
+ * @brief Write one GTF line as a BED row (see write_bed_row() in BedWriter.hpp)
+ * 
+ * @throws std::out_of_range if the line has no gene_id attribute
+ */
+template <typename Line>
+static void write_bed_row(BedWriter& bed, const Line& line, const std::vector<uint32_t>& keyIds)
+{
+    static const uint32_t gene_id = key_dictionary().id("gene_id");
+    write_bed_row(bed, line, gene_id, keyIds, [](const Line& l, uint32_t key) { return find_attribute(l, key); });
 }
 
 /**
@@ -118,9 +482,10 @@ void gtf2BedMain(std::vector<std::string>& argv)
  * that any requested feature types are actually present in the input file.
  * 
  * Processing steps:
- * 1. Opens and iterates through GTF/GFF file
+ * 1. Opens and iterates through GTF/GFF file, skipping lines of unwanted
+ *    feature types before their attributes are parsed
  * 2. Displays progress every 10,000 lines
- * 3. Extracts all attribute keys from each line
+ * 3. Extracts all attribute keys from each kept line
  * 4. Collects all unique feature types
  * 5. Validates requested feature types exist in file
  * 
@@ -130,33 +495,40 @@ void gtf2BedMain(std::vector<std::string>& argv)
  * @throws std::runtime_error via vrb.error() if requested feature types not found
  */
 void GTF2Bed::cacheGTFFile(std::string input_file, FileFormat format_) {
-    GTFFile gtf(input_file, format_);
+    RunStats::Timer opening(stats, RunStats::Open);
+    GTFFile gtf(input_file, format_, threads);
 
-    // Temporary set to collect all feature types present in file
-    std::unordered_set<std::string> tmpFeatureSet;
+    // Rejects unwanted feature types and collects all feature types present in file
+    FeatureFilter filter(featureTypes);
+    gtf.set_filter(&filter);
+    gtf.set_projection(parsedAttributes());
+    selectRegions(gtf);
+    ReadCounters reads;
+    gtf.set_read_counters(&reads);
+    opening.stop();
 
-    // Process each line in the GTF/GFF file
-    for (const GTFLine& line : gtf) {
-        // Display progress every 10,000 lines
-        if (linecount % 10000 == 0) vrb.bullet("Read" + std::to_string(linecount));
+    // Process each line in the GTF/GFF file; progress is printed by a background thread
+    RunStats::Timer parsing(stats, RunStats::Parse);
+    ProgressReporter progress("Read", input_size(input_file), [&gtf] { return gtf.consumed_bytes(); }, progress_printer(reportSteps));
+    for (const GTFLineView& line : gtf) {
+        progress.line();
         linecount++;
         
-        // Extract all attribute keys from this line
-        for (const auto& [key, value] : line.attributes) {
-            attribute_keys.insert(key);
-        }
-        
-        // Add feature type to set for validation
-        tmpFeatureSet.insert(line.feature);
-        
-        // Cache the line for later processing
+        // Cache the line in the arena for later processing
         cachedFile.push_back(line);
     }
+    progress.stop();
+    parsing.stop();
+    stats.add_reads(reads, RunStats::Parse);
+    count_lines(stats, filter);
+
+    // Every attribute key has its own column in the store: no per-line key collection
+    RunStats::Timer discovering(stats, RunStats::Keys);
+    for (uint32_t id : cachedFile.key_ids()) attribute_keys.emplace(key_dictionary().name(id));
+    discovering.stop();
 
     // Validate that all requested feature types are present in the file
-    if (!is_default_feature_type(featureTypes) && !is_present(featureTypes, tmpFeatureSet)) {
-        vrb.error("Not all features specified could be found in your input file. Exiting...");
-    }
+    checkFeatureTypes(filter);
 }
 
 /**
@@ -178,32 +550,926 @@ void GTF2Bed::cacheGTFFile(std::string input_file, FileFormat format_) {
  */
 void GTF2Bed::writeToBed(std::vector<std::string>& sortedKeys)
 {
-    output_file fdo(outFile.c_str());
+    // All rows are in memory already: --sort only reorders their indices
+    std::vector<uint32_t> order;
+    if (sortOutput) {
+        RunStats::Timer sorting(stats, RunStats::Sort);
+        if (snapshot) {
+            sort_rows(snapshotRows, *snapshot, threads);
+        } else {
+            order.resize(cachedFile.size());
+            std::iota(order.begin(), order.end(), 0u);
+            sort_rows(order, cachedFile, threads);
+        }
+    }
+
+    RunStats::Timer writing(stats, RunStats::Write); // outlives fdo, so closing the output is included
+    output_file fdo(outFile, threads);
+    if (fdo.fail()) fail("Cannot open output file [" + outFile + "]");
+    indexOutputFile(fdo);
 
     // Write header with standard BED columns plus all attributes
-    fdo << "#chr\tstart\tend\tid\tinfo\tstrand";
-    for (const std::string& item : sortedKeys) {
-        fdo << "\t" << item;
+    write_bed_header(fdo, sortedKeys);
+
+    // Write each GTF line in BED format
+    std::vector<uint32_t> keyIds = intern_keys(sortedKeys);
+    BedWriter bed(fdo);
+    if (snapshot) {
+        for (uint32_t row : snapshotRows) write_bed_row(bed, (*snapshot)[row], keyIds);
+        return;
+    }
+    if (sortOutput) {
+        for (uint32_t row : order) write_bed_row(bed, cachedFile[row], keyIds);
+        return;
+    }
+    for (const GTFRecord& line : cachedFile) {
+        write_bed_row(bed, line, keyIds);
+    }
+}
+
+/**
+ * @brief Rows go to fdo directly, or through a BedSorter that is merged into fdo at the end
+ */
+void GTF2Bed::writeRows(std::ostream& fdo, const std::function<void(std::ostream&)>& rows)
+{
+    if (!sortOutput) {
+        rows(fdo);
+        return;
+    }
+
+    BedSorter sorter(maxMemory, threads, tempDir);
+    {
+        boost::iostreams::stream<bed_sorter_sink> unsorted(bed_sorter_sink(sorter), 1 << 16);
+        rows(unsorted);
+    }
+
+    // Callers time the whole pass as write; the final sort and merge count as sort
+    RunStats::Timer sorting(stats, RunStats::Sort, RunStats::Write);
+    sorter.finish(fdo);
+    sorting.stop();
+    if (sorter.runs() > 0 && reportSteps) {
+        vrb.bullet("Sorted through " + std::to_string(sorter.runs()) + " runs (" + std::to_string(sorter.spilled_bytes() >> 20)
+                   + " MB) spilled to [" + tempDir + "]");
+    }
+}
+
+/**
+ * @brief Hand everything written to the output to the index builder
+ */
+void GTF2Bed::indexOutputFile(output_file& fdo)
+{
+    if (!indexOutput) return;
+    if (fdo.fail()) fail("Cannot open output file [" + outFile + "]"); // no writer was pushed either
+    std::shared_ptr<BGZFWriter> writer = fdo.bgzf_writer();
+    if (!writer) fail("Cannot index [" + outFile + "]: only bgzipped (.gz/.bgz) output can be indexed");
+    outputIndex.attach(writer);
+}
+
+/**
+ * @brief Save the tabix/CSI index of the closed output
+ */
+void GTF2Bed::writeIndex()
+{
+    RunStats::Timer writing(stats, RunStats::Write);
+    if (!outputIndex.sorted()) fail("Cannot index [" + outFile + "]: " + outputIndex.error());
+    const std::string indexFile = outputIndex.save(outFile);
+    if (reportSteps) {
+        vrb.bullet(std::string(outputIndex.csi() ? "CSI" : "Tabix") + " index of " + std::to_string(outputIndex.references())
+                   + " chromosomes written to [" + indexFile + "]");
+    }
+}
+
+/**
+ * @brief Estimate the memory of cacheGTFFile() from the input size
+ */
+bool GTF2Bed::cacheFitsMemory(const std::string& input_file) const
+{
+    if (!sortOutput) return true;
+    return cache_estimate(input_file) <= maxMemory;
+}
+
+/**
+ * @brief A snapshot is fresh if it opens and was built from this input, as this format
+ */
+bool GTF2Bed::snapshotIsFresh(const std::string& snapshot_file, const std::string& input_file, FileFormat format_) const
+{
+    if (!std::filesystem::exists(snapshot_file) || !std::filesystem::exists(input_file)) return false;
+    try {
+        AnnotationSnapshot existing(snapshot_file);
+        return existing.format() == format_ && existing.source() == g2b::SourceStamp::of(input_file);
+    } catch (const std::exception& e) {
+        vrb.warning("Rebuilding snapshot [" + snapshot_file + "]: " + e.what());
+        return false;
+    }
+}
+
+/**
+ * @brief Parse the whole input, without feature filter or projection, into a snapshot
+ */
+void GTF2Bed::buildSnapshot(std::string input_file, FileFormat format_, std::string snapshot_file)
+{
+    if (!std::filesystem::exists(input_file)) fail("Cannot open input file [" + input_file + "]");
+
+    // Stamped before reading, so a file changed meanwhile is rebuilt next time
+    const g2b::SourceStamp source = g2b::SourceStamp::of(input_file);
+
+    RunStats::Timer opening(stats, RunStats::Open);
+    GTFFile gtf(input_file, format_, threads);
+    ReadCounters reads;
+    gtf.set_read_counters(&reads);
+    opening.stop();
+
+    RunStats::Timer parsing(stats, RunStats::Parse);
+    AnnotationStore store;
+    ProgressReporter progress("Read", input_size(input_file), [&gtf] { return gtf.consumed_bytes(); }, progress_printer(reportSteps));
+    for (const GTFLineView& line : gtf) {
+        progress.line();
+        store.push_back(line);
+    }
+    progress.stop();
+    parsing.stop();
+    stats.add_reads(reads, RunStats::Parse);
+
+    RunStats::Timer writing(stats, RunStats::Write);
+    g2b::write_snapshot(store, format_, source, snapshot_file);
+    vrb.bullet("Wrote snapshot [" + snapshot_file + "] of " + std::to_string(store.size()) + " lines");
+}
+
+/**
+ * @brief Map a snapshot and select its rows, as cacheGTFFile() does for text input
+ */
+void GTF2Bed::loadSnapshot(std::string snapshot_file)
+{
+    RunStats::Timer opening(stats, RunStats::Open);
+    snapshot = std::make_unique<AnnotationSnapshot>(snapshot_file);
+    opening.stop();
+
+    // Region and feature filtering on the mapped columns
+    RunStats::Timer parsing(stats, RunStats::Parse);
+    FeatureFilter filter(featureTypes);
+    snapshotRows.clear();
+    snapshotRows.reserve(snapshot->size());
+    for (std::size_t row = 0; row < snapshot->size(); ++row) {
+        if (!regions.empty()) {
+            const SnapshotRecord line = (*snapshot)[row];
+            if (!regions.overlaps(line.seqname, line.start - 1, line.end)) continue;
+        }
+        if (filter.accept(snapshot->feature(row))) snapshotRows.push_back(static_cast<uint32_t>(row));
+    }
+    linecount += snapshotRows.size();
+    parsing.stop();
+    count_lines(stats, filter);
+
+    // A key becomes a column if one of the kept rows has it; with every row kept, every key does
+    RunStats::Timer discovering(stats, RunStats::Keys);
+    const bool allRowsKept = filter.accepts_all() && regions.empty() && !snapshotRows.empty();
+    for (std::size_t i = 0; i < snapshot->attribute_count(); ++i) {
+        bool present = allRowsKept;
+        for (std::size_t j = 0; !present && j < snapshotRows.size(); ++j) present = snapshot->has_attribute(i, snapshotRows[j]);
+        if (present) attribute_keys.emplace(key_dictionary().name(snapshot->attribute_key(i)));
+    }
+    discovering.stop();
+
+    checkFeatureTypes(filter);
+}
+
+/**
+ * @brief Return the collected attribute keys in sorted order
+ */
+std::vector<std::string> GTF2Bed::sortedAttributeKeys() const
+{
+    std::vector<std::string> sortedKeys;
+    for (const std::string& key : attribute_keys) {
+        // gene_id is parsed for the name column even when it was not requested
+        if (attributeProjection.empty()
+            || std::find(attributeProjection.begin(), attributeProjection.end(), key) != attributeProjection.end()) {
+            sortedKeys.push_back(key);
+        }
+    }
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    return sortedKeys;
+}
+
+/**
+ * @brief Attribute keys the parser materialises: the --attributes projection plus gene_id
+ */
+std::vector<std::string> GTF2Bed::parsedAttributes() const
+{
+    return with_gene_id(attributeProjection);
+}
+
+/**
+ * @brief Throw for a file of a batch, so the other files go on; exit through vrb.error() otherwise
+ */
+void GTF2Bed::fail(const std::string& message) const
+{
+    if (batchJob) throw std::runtime_error(message);
+    vrb.error(message);
+}
+
+/**
+ * @brief Exit with an error if a requested feature type never occurred in the input
+ */
+void GTF2Bed::checkFeatureTypes(const FeatureFilter& filter) const
+{
+    if (!is_default_feature_type(featureTypes) && !is_present(featureTypes, filter.seen())) {
+        // A region may simply hold none of them
+        if (!regions.empty()) {
+            vrb.warning("Not all features specified occur in the selected regions");
+            return;
+        }
+        if (batchJob) throw std::runtime_error("Not all features specified could be found in the input file");
+        vrb.error("Not all features specified could be found in your input file. Exiting...");
+    }
+}
+
+/**
+ * @brief Load input_file.tbi/.csi if the input is bgzipped, otherwise regions are found by scanning
+ */
+void GTF2Bed::openInputIndex(const std::string& input_file)
+{
+    RunStats::Timer opening(stats, RunStats::Open);
+    const std::string indexFile = TabixReader::find_for(input_file);
+    if (indexFile.empty()) {
+        if (reportSteps) vrb.bullet("No tabix/CSI index next to the input: scanning it for the regions");
+        return;
+    }
+    if (detect_compression(input_file) != Compression::BGZF) {
+        vrb.warning("Ignoring index [" + indexFile + "]: only bgzipped input can be read through an index");
+        return;
+    }
+    std::error_code ec;
+    if (std::filesystem::last_write_time(indexFile, ec) < std::filesystem::last_write_time(input_file, ec)) {
+        vrb.warning("Index [" + indexFile + "] is older than the input");
+    }
+
+    try {
+        inputIndex = std::make_unique<TabixReader>(indexFile);
+    } catch (const std::exception& e) {
+        fail(e.what());
+    }
+    std::size_t missing = 0;
+    for (const std::string& chr : regions.chromosomes()) missing += !inputIndex->has(chr);
+    if (missing > 0) vrb.warning(std::to_string(missing) + " region sequences do not occur in index [" + indexFile + "]");
+    if (reportSteps) vrb.bullet("Reading the regions through index [" + indexFile + "]");
+}
+
+/**
+ * @brief Hand the regions to the parser and, with an index, read only their chunks
+ */
+void GTF2Bed::selectRegions(GTFFile& gtf) const
+{
+    if (regions.empty()) return;
+    gtf.set_regions(&regions);
+    if (inputIndex) gtf.read_chunks(inputIndex->chunks(regions));
+}
+
+/**
+ * @brief First streaming pass: collect attribute keys and feature types
+ * 
+ * Same filtering, key discovery and feature validation as cacheGTFFile(),
+ * but lines are dropped as soon as they are parsed.
+ * 
+ * @param input_file Path to input GTF/GFF/GFF3 file
+ * @param format_ File format enum (GTF, GFF, or GFF3)
+ * 
+ * @throws std::runtime_error via vrb.error() if requested feature types not found
+ */
+void GTF2Bed::scanGTFFile(std::string input_file, FileFormat format_)
+{
+    FeatureFilter filter(featureTypes);
+
+    if (useParallel(input_file)) {
+        scanChunksParallel(input_file, format_, filter);
+        count_lines(stats, filter);
+        checkFeatureTypes(filter);
+        return;
+    }
+
+    RunStats::Timer opening(stats, RunStats::Open);
+    GTFFile gtf(input_file, format_, threads);
+    gtf.set_filter(&filter);
+    gtf.set_projection(parsedAttributes());
+    selectRegions(gtf);
+    ReadCounters reads;
+    gtf.set_read_counters(&reads);
+    opening.stop();
+
+    // Key collection is interleaved with parsing here, so it is timed as parse
+    RunStats::Timer parsing(stats, RunStats::Parse);
+    ProgressReporter progress("Read", input_size(input_file), [&gtf] { return gtf.consumed_bytes(); }, progress_printer(reportSteps));
+    std::vector<char> seenKeys;
+    for (const GTFLineView& line : gtf) {
+        progress.line();
+        linecount++;
+
+        collect_keys(line, seenKeys, attribute_keys);
+    }
+    progress.stop();
+    parsing.stop();
+    stats.add_reads(reads, RunStats::Parse);
+    count_lines(stats, filter);
+
+    checkFeatureTypes(filter);
+}
+
+/**
+ * @brief Second streaming pass: re-read the input and write BED rows directly
+ * 
+ * @param input_file Path to input GTF/GFF/GFF3 file
+ * @param format_ File format enum (GTF, GFF, or GFF3)
+ * @param sortedKeys Vector of sorted attribute keys for consistent column ordering
+ */
+void GTF2Bed::streamToBed(std::string input_file, FileFormat format_, std::vector<std::string>& sortedKeys)
+{
+    // The second pass parses again; that time is part of the write phase
+    RunStats::Timer writing(stats, RunStats::Write);
+    output_file fdo(outFile, threads);
+    if (fdo.fail()) fail("Cannot open output file [" + outFile + "]");
+    indexOutputFile(fdo);
+    write_bed_header(fdo, sortedKeys);
+
+    // Feature types were validated by the scan pass
+    FeatureFilter filter(featureTypes);
+
+    if (useParallel(input_file)) {
+        writeRows(fdo, [&](std::ostream& out) {
+            writeChunksParallel(input_file, format_, sortedKeys, parsedAttributes(), out, filter);
+        });
+        return;
+    }
+
+    ReadCounters reads;
+    writeRows(fdo, [&](std::ostream& out) {
+        GTFFile gtf(input_file, format_, threads);
+        gtf.set_filter(&filter);
+        gtf.set_projection(parsedAttributes());
+        selectRegions(gtf);
+        gtf.set_read_counters(&reads);
+        std::vector<uint32_t> keyIds = intern_keys(sortedKeys);
+        BedWriter bed(out);
+        ProgressReporter progress("Wrote", input_size(input_file), [&gtf] { return gtf.consumed_bytes(); }, progress_printer(reportSteps));
+        for (const GTFLineView& line : gtf) {
+            progress.line();
+            write_bed_row(bed, line, keyIds);
+        }
+    });
+    stats.add_reads(reads, RunStats::Write, true); // scanGTFFile() counted the input bytes
+}
+
+/**
+ * @brief Single-pass conversion with a user-supplied column schema
+ * 
+ * The header is written before the input is opened and each line is written
+ * as soon as it is parsed. Feature types are validated once the input has
+ * been read, since nothing is known about the file before that.
+ * 
+ * @param input_file Path to input GTF/GFF/GFF3 file
+ * @param format_ File format enum (GTF, GFF, or GFF3)
+ * @param schemaKeys Attribute columns to write, in output order
+ * 
+ * @throws std::runtime_error via vrb.error() if requested feature types not found
+ */
+void GTF2Bed::convertWithSchema(std::string input_file, FileFormat format_, std::vector<std::string>& schemaKeys)
+{
+    // Parsing and writing are interleaved in this single pass: both count as write
+    RunStats::Timer writing(stats, RunStats::Write);
+    output_file fdo(outFile, threads);
+    if (fdo.fail()) fail("Cannot open output file [" + outFile + "]");
+    indexOutputFile(fdo);
+    write_bed_header(fdo, schemaKeys);
+
+    FeatureFilter filter(featureTypes);
+
+    // Attributes outside the schema are never decoded
+    const std::vector<std::string> projection = with_gene_id(schemaKeys);
+
+    if (useParallel(input_file)) {
+        writeRows(fdo, [&](std::ostream& out) {
+            writeChunksParallel(input_file, format_, schemaKeys, projection, out, filter);
+        });
+    } else {
+        ReadCounters reads;
+        writeRows(fdo, [&](std::ostream& out) {
+            GTFFile gtf(input_file, format_, threads);
+            gtf.set_filter(&filter);
+            gtf.set_projection(projection);
+            selectRegions(gtf);
+            gtf.set_read_counters(&reads);
+            std::vector<uint32_t> keyIds = intern_keys(schemaKeys);
+            BedWriter bed(out);
+            ProgressReporter progress("Read", input_size(input_file), [&gtf] { return gtf.consumed_bytes(); }, progress_printer(reportSteps));
+            for (const GTFLineView& line : gtf) {
+                progress.line();
+                linecount++;
+
+                write_bed_row(bed, line, keyIds);
+            }
+        });
+        stats.add_reads(reads, RunStats::Write);
+    }
+
+    count_lines(stats, filter);
+    checkFeatureTypes(filter);
+}
+
+//------------------------//
+//  POSITION ANNOTATION   //
+//------------------------//
+
+// Column n (0-based) of a tab-separated line, empty if the line is shorter
+static std::string_view nth_column(std::string_view line, std::size_t n)
+{
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    std::size_t begin = 0;
+    for (; n > 0; --n) {
+        begin = line.find('\t', begin);
+        if (begin == std::string_view::npos) return {};
+        ++begin;
     }
+    return line.substr(begin, line.find('\t', begin) - begin);
+}
+
+/**
+ * @brief Index the cached (or snapshot) rows by position, one tree per sequence
+ */
+void GTF2Bed::buildIntervalIndex()
+{
+    RunStats::Timer indexing(stats, RunStats::Sort);
+    intervals = IntervalIndex();
+    if (snapshot) {
+        for (uint32_t row : snapshotRows) {
+            const SnapshotRecord line = (*snapshot)[row];
+            intervals.add(line.seqname, static_cast<int64_t>(line.start) - 1, line.end, row);
+        }
+    } else {
+        for (uint32_t row = 0; row < cachedFile.size(); ++row) {
+            const GTFRecord line = cachedFile[row];
+            intervals.add(line.seqname, static_cast<int64_t>(line.start) - 1, line.end, row);
+        }
+    }
+    intervals.build();
+}
+
+/**
+ * @brief Write one row per (position, overlapping feature) pair in a single pass over the positions
+ * 
+ * Positions sorted by sequence and start are answered by a sweep over the
+ * features; out-of-order positions fall back to a tree query, so any input
+ * order works.
+ */
+void GTF2Bed::annotatePositions(const std::string& positions_file, std::vector<std::string>& sortedKeys, bool nearest)
+{
+    if (!intervals.built() || intervals.size() == 0) buildIntervalIndex();
+
+    RunStats::Timer writing(stats, RunStats::Write);
+    ::input_file fdp(positions_file); // the member input_file names the GTF input
+    if (fdp.fail()) fail("Cannot open positions file [" + positions_file + "]");
+    output_file fdo(outFile, threads);
+    if (fdo.fail()) fail("Cannot open output file [" + outFile + "]");
+
+    fdo << "#query_chr\tquery_start\tquery_end\tquery_name";
+    if (nearest) fdo << "\tdistance";
+    fdo << "\tchr\tstart\tend\tid\tinfo\tstrand";
+    for (const std::string& item : sortedKeys) fdo << "\t" << item;
     fdo << "\n";
 
-    // Write each GTF line in BED format
-    for (const GTFLine& line : cachedFile) {
-        fdo << line.seqname << "\t";
-        fdo << std::to_string(line.start - 1) << "\t";  // Convert to 0-based start
-        fdo << std::to_string(line.end) << "\t";        // Keep 1-based end
-        fdo << line.attributes.at("gene_id") << "\t";   // Use gene_id as BED name
-        fdo << line.feature << "\t";                    // Feature type in info field
-        fdo << line.score;                              // Score field
-        
-        // Add all attributes in sorted order
-        for (const std::string& key : sortedKeys) {
-            if (line.attributes.count(key)) {
-                fdo << "\t" << line.attributes.at(key);
-            } else {
-                fdo << "\t.";  // Fill missing attributes with "."
+    const std::vector<uint32_t> keyIds = intern_keys(sortedKeys);
+    BedWriter bed(fdo);
+    IntervalIndex::Sweep sweep(intervals);
+    std::vector<uint32_t> hits;
+    bool vcf = boost::contains(positions_file, ".vcf");
+    uint64_t queries = 0, annotated = 0;
+
+    // Query columns; distance is left out without --nearest, "." for a position without a hit
+    GenomicRegion query;
+    std::string_view name;
+    auto write_query = [&](int64_t distance) {
+        bed.append(query.chr);
+        bed.append('\t');
+        bed.append(query.begin);
+        bed.append('\t');
+        bed.append(query.end);
+        bed.append('\t');
+        bed.append(name);
+        if (nearest) {
+            bed.append('\t');
+            if (distance < 0) bed.append('.');
+            else bed.append(distance);
+        }
+        bed.append('\t');
+    };
+    auto write_feature = [&](uint32_t row) {
+        if (snapshot) write_bed_row(bed, (*snapshot)[row], keyIds);
+        else write_bed_row(bed, cachedFile[row], keyIds);
+    };
+
+    std::string buffer;
+    while (std::getline(fdp, buffer)) {
+        if (boost::starts_with(buffer, "##fileformat=VCF")) vcf = true;
+        if (buffer.empty() || buffer[0] == '#' || boost::starts_with(buffer, "track") || boost::starts_with(buffer, "browser")) continue;
+        try {
+            query = vcf ? GenomicRegion::parse_vcf(buffer) : GenomicRegion::parse_bed(buffer);
+        } catch (const std::invalid_argument& e) {
+            fail(e.what());
+        }
+
+        name = nth_column(buffer, vcf ? 2 : 3); // the VCF ID, or the BED name
+        if (name.empty()) name = ".";
+        queries++;
+
+        hits.clear();
+        sweep.overlaps(query.chr, query.begin, query.end, [&hits](const IntervalIndex::Interval& interval) { hits.push_back(interval.value); });
+        if (!hits.empty()) {
+            annotated++;
+            for (uint32_t row : hits) {
+                write_query(0);
+                write_feature(row);
+            }
+            continue;
+        }
+        if (nearest) {
+            if (const auto closest = intervals.nearest(query.chr, query.begin, query.end)) {
+                annotated++;
+                write_query(closest->distance);
+                write_feature(closest->value);
+                continue;
+            }
+        }
+        write_query(-1);
+        bed.append('.');
+        bed.append_missing(5 + keyIds.size());
+        bed.end_row();
+    }
+    vrb.bullet("Annotated " + std::to_string(annotated) + " of " + std::to_string(queries) + " positions");
+}
+
+//------------------------//
+//  PARALLEL CHUNK PATH   //
+//------------------------//
+
+// Calls fn for every data line of a newline-aligned chunk
+template <typename Fn>
+static void for_each_data_line(std::string_view chunk, Fn&& fn)
+{
+    std::size_t pos = 0;
+    while (pos < chunk.size()) {
+        std::size_t nl = chunk.find('\n', pos);
+        if (nl == std::string_view::npos) nl = chunk.size();
+        std::string_view line = chunk.substr(pos, nl - pos);
+        pos = nl + 1;
+        if (line.empty() || line[0] == '#') continue; // skip comments and empty lines
+        fn(line);
+    }
+}
+
+// Number of chunks handed to the pool: several per thread to balance uneven lines
+static std::size_t chunk_count(std::size_t bytes, unsigned int threads)
+{
+    const std::size_t min_chunk = 1 << 20;   // 1 MB
+    const std::size_t max_chunk = 16 << 20;  // 16 MB, bounds per-chunk output buffers
+    std::size_t n = std::max<std::size_t>(threads * 4, bytes / max_chunk + 1);
+    return std::max<std::size_t>(1, std::min(n, bytes / min_chunk + 1));
+}
+
+bool GTF2Bed::useParallel(const std::string& input_file) const
+{
+    return threads > 1 && !is_compressed_file(input_file);
+}
+
+void GTF2Bed::scanChunksParallel(std::string input_file, FileFormat format_, FeatureFilter& filter)
+{
+    using StringSet = std::unordered_set<std::string, string_hash, std::equal_to<>>;
+    struct ChunkResult {
+        explicit ChunkResult(const FeatureFilter& selection) : filter(selection) {}
+        StringSet keys;
+        FeatureFilter filter;
+        unsigned int lines = 0;
+    };
+
+    RunStats::Timer opening(stats, RunStats::Open);
+    MappedFile mapped(input_file);
+    std::string_view data = mapped.data();
+    auto chunks = newline_aligned_chunks(data, chunk_count(data.size(), threads));
+    stats.text_bytes_in = std::max<uint64_t>(stats.text_bytes_in, data.size());
+    opening.stop();
+
+    // Workers start from an empty copy; what they see is merged into filter below
+    RunStats::Timer parsing(stats, RunStats::Parse);
+    const FeatureFilter selection = filter.selection();
+    const std::vector<std::string> projection = parsedAttributes();
+    const RegionSet* regionSet = regions.empty() ? nullptr : &regions;
+
+    ThreadPool pool(threads);
+    std::vector<std::future<ChunkResult>> results;
+    for (const auto& [begin, end] : chunks) {
+        std::string_view chunk = data.substr(begin, end - begin);
+        results.push_back(pool.submit([chunk, format_, &selection, &projection, regionSet] {
+            ChunkResult result(selection);
+            GTFParser parser(format_, &result.filter, regionSet);
+            parser.project(projection);
+            GTFLineView line;
+            std::vector<char> seenKeys;
+            for_each_data_line(chunk, [&](std::string_view text) {
+                if (!parser.parse_line(text, line)) return;
+                result.lines++;
+                collect_keys(line, seenKeys, result.keys);
+            });
+            return result;
+        }));
+    }
+
+    // Merge per-chunk discoveries; progress advances as chunks complete, in order
+    std::atomic<uint64_t> finished{0};
+    ProgressReporter progress("Read", data.size(), [&finished] { return finished.load(std::memory_order_relaxed); },
+                              progress_printer(reportSteps));
+    std::vector<ChunkResult> done;
+    done.reserve(results.size());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        done.push_back(results[i].get());
+        progress.add_lines(done.back().lines);
+        finished.fetch_add(chunks[i].second - chunks[i].first, std::memory_order_relaxed);
+    }
+    progress.stop();
+    parsing.stop();
+
+    RunStats::Timer discovering(stats, RunStats::Keys);
+    for (ChunkResult& result : done) {
+        linecount += result.lines;
+        attribute_keys.merge(result.keys);
+        filter.merge(result.filter);
+    }
+    discovering.stop();
+}
+
+void GTF2Bed::writeChunksParallel(std::string input_file, FileFormat format_, const std::vector<std::string>& sortedKeys,
+                                  const std::vector<std::string>& projection, std::ostream& fdo, FeatureFilter& filter)
+{
+    struct ChunkResult {
+        explicit ChunkResult(const FeatureFilter& selection) : filter(selection) {}
+        std::string bed;
+        FeatureFilter filter;
+        unsigned int lines = 0;
+    };
+
+    MappedFile mapped(input_file);
+    std::string_view data = mapped.data();
+    auto chunks = newline_aligned_chunks(data, chunk_count(data.size(), threads));
+
+    const std::vector<uint32_t> keyIds = intern_keys(sortedKeys);
+    const FeatureFilter selection = filter.selection();
+    const RegionSet* regionSet = regions.empty() ? nullptr : &regions;
+    auto convert = [&keyIds, format_, &selection, &projection, regionSet](std::string_view chunk) {
+        ChunkResult result(selection);
+        BedWriter bed(chunk.size() + chunk.size() / 4);
+        GTFParser parser(format_, &result.filter, regionSet);
+        parser.project(projection);
+        GTFLineView line;
+        for_each_data_line(chunk, [&](std::string_view text) {
+            if (!parser.parse_line(text, line)) return;
+            result.lines++;
+            write_bed_row(bed, line, keyIds);
+        });
+        result.bed = bed.take();
+        return result;
+    };
+
+    // Declared after convert so that workers are joined before it goes away
+    ThreadPool pool(threads);
+
+    std::atomic<uint64_t> finished{0};
+    ProgressReporter progress("Wrote", data.size(), [&finished] { return finished.load(std::memory_order_relaxed); },
+                              progress_printer(reportSteps));
+
+    // Keep a bounded window of chunks in flight and write them back in order
+    const std::size_t window = static_cast<std::size_t>(threads) * 2;
+    std::deque<std::future<ChunkResult>> pending;
+    std::size_t next = 0, written = 0;
+    while (next < chunks.size() || !pending.empty()) {
+        while (next < chunks.size() && pending.size() < window) {
+            std::string_view chunk = data.substr(chunks[next].first, chunks[next].second - chunks[next].first);
+            pending.push_back(pool.submit([&convert, chunk] { return convert(chunk); }));
+            next++;
+        }
+        ChunkResult result = pending.front().get();
+        pending.pop_front();
+        linecount += result.lines;
+        filter.merge(result.filter);
+        fdo.write(result.bed.data(), static_cast<std::streamsize>(result.bed.size()));
+        progress.add_lines(result.lines);
+        finished.fetch_add(chunks[written].second - chunks[written].first, std::memory_order_relaxed);
+        written++;
+    }
+}
+
+//------------------------//
+//   BATCH CONVERSION     //
+//------------------------//
+
+// JSON string literal of s
+static std::string json_quote(const std::string& s)
+{
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) quoted += ' ';
+        else quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static std::string fixed_seconds(double seconds)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << seconds;
+    return out.str();
+}
+
+// Converts one file of a batch on the calling thread; failures are recorded, not fatal,
+// and leave no partial output behind
+static void convert_batch_file(GTF2Bed& job, BatchFile& file, std::vector<std::string> schemaKeys)
+{
+    const double start = run_stats::wall_seconds();
+    try {
+        if (!job.regions.empty()) job.openInputIndex(file.input);
+        runConversion(job, file.format, schemaKeys);
+    } catch (const std::exception& e) {
+        std::error_code ec;
+        for (const char* suffix : {"", ".tbi", ".csi"}) std::filesystem::remove(file.output + suffix, ec);
+        file.error = e.what();
+    }
+    file.seconds = run_stats::wall_seconds() - start;
+    file.mode = job.stats.mode;
+    file.lines_kept = job.stats.lines_kept;
+    file.lines_filtered = job.stats.lines_filtered;
+    std::error_code ec;
+    file.bytes_out = std::filesystem::file_size(file.output, ec);
+    if (ec) file.bytes_out = 0;
+}
+
+/**
+ * @brief Workers take the largest waiting file whose memory share is free, until none is left
+ */
+void convertBatch(const GTF2Bed& settings, std::vector<BatchFile>& files, const std::vector<std::string>& schemaKeys)
+{
+    if (files.empty()) return;
+    const unsigned int workers = static_cast<unsigned int>(std::min<std::size_t>(std::max(1u, settings.threads), files.size()));
+    const unsigned int threadsPerFile = std::max(1u, settings.threads / workers);
+    const uint64_t budget = settings.maxMemory;
+    const uint64_t sortShare = settings.sortOutput ? budget / workers : 0;
+
+    // One converter per file with the shared settings. Only the cached path holds the
+    // file in memory; the others need at most a worker's share for --sort runs.
+    std::vector<std::unique_ptr<GTF2Bed>> jobs;
+    for (BatchFile& file : files) {
+        auto job = std::make_unique<GTF2Bed>();
+        job->input_file = file.input;
+        job->outFile = file.output;
+        job->featureTypes = settings.featureTypes;
+        job->attributeProjection = settings.attributeProjection;
+        job->regions = settings.regions;
+        job->options = settings.options;
+        job->sortOutput = settings.sortOutput;
+        job->indexOutput = settings.indexOutput;
+        job->tempDir = settings.tempDir;
+        job->threads = threadsPerFile;
+        job->streaming = settings.streaming;
+        job->reportSteps = false;
+        job->batchJob = true;
+
+        file.bytes = input_size(file.input);
+        const uint64_t cache = cache_estimate(file.input);
+        const bool constantMemory = !schemaKeys.empty() || job->streaming || job->useParallel(file.input);
+        file.streamed = !constantMemory && cache > budget;
+        job->streaming = job->streaming || file.streamed;
+        file.reserved = constantMemory || file.streamed ? sortShare : cache;
+        job->maxMemory = constantMemory || file.streamed ? std::max<uint64_t>(sortShare, 1) : budget;
+        jobs.push_back(std::move(job));
+    }
+
+    // Largest first: a big file started last would leave the other workers idle
+    std::vector<std::size_t> order(files.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&files](std::size_t a, std::size_t b) { return files[a].bytes > files[b].bytes; });
+
+    vrb.bullet("Converting " + std::to_string(files.size()) + " files, " + std::to_string(workers) + " at a time with "
+               + std::to_string(threadsPerFile) + " thread(s) each, within " + std::to_string(budget >> 20) + " MB");
+
+    // Every share fits the budget and all of it is free once nothing runs, so some file can always start
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    std::mutex mutex;
+    std::condition_variable released;
+    uint64_t available = budget;
+    std::size_t waiting = files.size();
+    std::vector<char> started(files.size(), 0);
+    auto take = [&](std::size_t& index) {
+        if (waiting == 0) {
+            index = none;
+            return true;
+        }
+        for (std::size_t i : order) {
+            if (started[i] || files[i].reserved > available) continue;
+            started[i] = 1;
+            waiting--;
+            available -= files[i].reserved;
+            index = i;
+            return true;
+        }
+        return false;
+    };
+
+    auto work = [&] {
+        while (true) {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                released.wait(lock, [&] { return take(index); });
+            }
+            if (index == none) return;
+            convert_batch_file(*jobs[index], files[index], schemaKeys);
+            jobs[index].reset(); // its cache is gone before its share is handed back
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                available += files[index].reserved;
             }
+            released.notify_all();
+        }
+    };
+    ThreadPool pool(workers);
+    std::vector<std::future<void>> done;
+    for (unsigned int w = 0; w < workers; ++w) done.push_back(pool.submit(work));
+    for (std::future<void>& worker : done) worker.get();
+}
+
+/**
+ * @brief Rows of "input output [format]", separated by tabs or spaces
+ */
+std::vector<BatchFile> readManifest(const std::string& manifest_file, const std::string& default_format)
+{
+    input_file fdm(manifest_file);
+    if (fdm.fail()) vrb.error("Cannot open manifest [" + manifest_file + "]");
+    std::vector<BatchFile> files;
+    std::string buffer;
+    for (std::size_t row = 1; std::getline(fdm, buffer); ++row) {
+        std::vector<std::string> columns;
+        boost::split(columns, buffer, boost::is_any_of(" \t\r"), boost::token_compress_on);
+        std::erase_if(columns, [](const std::string& column) { return column.empty(); });
+        if (columns.empty() || columns[0][0] == '#') continue;
+        if (columns.size() > 3 || columns.size() < 2) {
+            vrb.error("Row " + std::to_string(row) + " of manifest [" + manifest_file + "] is not \"input output [format]\"");
+        }
+        if (columns.size() == 2 && default_format.empty()) {
+            vrb.error("Row " + std::to_string(row) + " of manifest [" + manifest_file + "] names no format, and --format is not given");
+        }
+        BatchFile file;
+        file.input = columns[0];
+        file.output = columns[1];
+        file.format = parse_format(columns.size() == 3 ? columns[2] : default_format);
+        files.push_back(std::move(file));
+    }
+    return files;
+}
+
+/**
+ * @brief One line per file in the order given, then the totals
+ */
+void reportBatch(const std::vector<BatchFile>& files, double seconds, const std::string& json_file)
+{
+    vrb.title("Batch summary");
+    std::size_t failed = 0;
+    uint64_t bytes_in = 0, bytes_out = 0, lines = 0;
+    for (const BatchFile& file : files) {
+        if (!file.error.empty()) {
+            failed++;
+            vrb.bullet(file.input + ": FAILED (" + file.error + ")");
+            continue;
+        }
+        bytes_in += file.bytes;
+        bytes_out += file.bytes_out;
+        lines += file.lines_kept;
+        vrb.bullet(file.input + " -> " + file.output + ": " + std::to_string(file.lines_kept) + " lines in "
+                   + fixed_seconds(file.seconds) + " s (" + file.mode + ")");
+    }
+    vrb.bullet("Converted " + std::to_string(files.size() - failed) + " of " + std::to_string(files.size()) + " files, "
+               + std::to_string(lines) + " lines, " + std::to_string(bytes_in >> 20) + " MB in, "
+               + std::to_string(bytes_out >> 20) + " MB out, in " + fixed_seconds(seconds) + " s");
+
+    if (!json_file.empty()) {
+        std::ofstream json(json_file);
+        if (!json) vrb.error("Cannot open statistics file [" + json_file + "]");
+        json << std::setprecision(6) << std::fixed;
+        json << "{\n  \"wall_seconds\": " << seconds << ",\n  \"peak_rss_bytes\": " << run_stats::peak_rss_bytes()
+             << ",\n  \"files\": [";
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            const BatchFile& file = files[i];
+            json << (i ? ",\n" : "\n") << "    {\"input\": " << json_quote(file.input) << ", \"output\": " << json_quote(file.output)
+                 << ", \"status\": \"" << (file.error.empty() ? "converted" : "failed") << "\", \"error\": "
+                 << (file.error.empty() ? "null" : json_quote(file.error)) << ", \"mode\": " << json_quote(file.mode)
+                 << ", \"streamed\": " << (file.streamed ? "true" : "false") << ", \"seconds\": " << file.seconds
+                 << ", \"bytes_in\": " << file.bytes << ", \"bytes_out\": " << file.bytes_out
+                 << ", \"lines_kept\": " << file.lines_kept << ", \"lines_filtered\": " << file.lines_filtered << "}";
         }
-        fdo << "\n";
+        json << "\n  ]\n}\n";
     }
+    if (failed > 0) vrb.error(std::to_string(failed) + " of " + std::to_string(files.size()) + " files failed");
 }
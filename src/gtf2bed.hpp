@@ -22,6 +22,13 @@ class GTF2Bed {
         GTF2Bed()
         {
             linecount = 0;
+            threads = 1;
+            sortOutput = false;
+            indexOutput = false;
+            maxMemory = 0;
+            streaming = false;
+            reportSteps = true;
+            batchJob = false;
         }
         
         /**
@@ -39,9 +46,25 @@ class GTF2Bed {
         std::unordered_set<std::string> featureTypes;    ///< Set of feature types to include in output
         
         unsigned int linecount;                          ///< Counter for processed lines (for progress tracking)
+        unsigned int threads;                            ///< Number of worker threads for chunked parsing or BGZF inflation
+        bool sortOutput;                                 ///< Write rows in (chr, start, end) order (--sort)
+        uint64_t maxMemory;                              ///< Bytes of rows --sort keeps in memory before spilling runs to disk
+        std::string tempDir;                             ///< Directory of the --sort run files
+        bool indexOutput;                                ///< Build a tabix/CSI index of the bgzipped output (--index)
+        bool streaming;                                  ///< Convert in two passes without caching the input (--streaming)
+        bool reportSteps;                                ///< Print progress and step messages; off for the files of a batch
+        bool batchJob;                                   ///< One file of a batch: its errors are thrown, so the other files go on
 
-        std::vector<GTFLine> cachedFile;                 ///< Cached GTF/GFF lines for processing
-        std::unordered_set<std::string> attribute_keys;  ///< Set of all attribute keys found in input file
+        AnnotationStore cachedFile;                      ///< Cached GTF/GFF lines, backed by an arena
+        std::unique_ptr<AnnotationSnapshot> snapshot;    ///< Mapped .g2b snapshot (--cache); used instead of cachedFile when set
+        std::vector<uint32_t> snapshotRows;              ///< Snapshot rows kept by the feature filter
+        std::unordered_set<std::string, string_hash, std::equal_to<>> attribute_keys;  ///< Set of all attribute keys found in input file
+        std::vector<std::string> attributeProjection;    ///< Attribute keys to parse and write (--attributes), empty for all
+        RunStats stats;                                  ///< Phase timings and I/O counters (--stats)
+        TabixIndex outputIndex;                          ///< Index fed by the output writer (--index)
+        RegionSet regions;                               ///< Only lines overlapping these are converted (--region/--regions-bed)
+        std::unique_ptr<TabixReader> inputIndex;         ///< Tabix/CSI index of the BGZF input, to seek to the regions
+        IntervalIndex intervals;                         ///< Cached rows by position (--annotate); values are row numbers
 
         // OPTIONS
         boost::program_options::options_description option_descriptions;  ///< Command line option descriptions
@@ -50,8 +73,10 @@ class GTF2Bed {
         /**
          * @brief Cache GTF/GFF file contents in memory
          * 
-         * Reads the entire GTF/GFF/GFF3 file into memory, extracts all attribute keys,
+         * Reads the GTF/GFF/GFF3 file into memory, extracts all attribute keys,
          * and validates that requested feature types are present in the file.
+         * Lines of other feature types are skipped before their attributes are
+         * parsed, so they are neither cached nor contribute attribute columns.
          * 
          * @param input_file Path to the input GTF/GFF/GFF3 file
          * @param format_ File format (GTF, GFF, or GFF3)
@@ -60,22 +85,335 @@ class GTF2Bed {
          */
         void cacheGTFFile(std::string input_file, FileFormat format_);
 
+        /**
+         * @brief Check whether a .g2b snapshot can be used for an input file
+         * 
+         * @param snapshot_file Path to the snapshot
+         * @param input_file Path to the GTF/GFF/GFF3 file it should have been built from
+         * @param format_ File format the input is read as
+         * @return true if the snapshot is readable and matches the input's size, mtime and sampled hash
+         */
+        bool snapshotIsFresh(const std::string& snapshot_file, const std::string& input_file, FileFormat format_) const;
+
+        /**
+         * @brief Parse a GTF/GFF file completely and save it as a .g2b snapshot
+         * 
+         * Every feature type and attribute is kept, so the snapshot serves any
+         * later --feature-type or --attributes selection.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * @param snapshot_file Path the snapshot is written to
+         */
+        void buildSnapshot(std::string input_file, FileFormat format_, std::string snapshot_file);
+
+        /**
+         * @brief Memory-map a .g2b snapshot in place of cacheGTFFile()
+         * 
+         * Applies the feature filter to the snapshot rows, collects the attribute
+         * keys of the kept rows and validates the requested feature types.
+         * writeToBed() then reads rows straight from the mapping.
+         * 
+         * @param snapshot_file Path to the snapshot
+         * 
+         * @throws std::runtime_error if the file is not a valid snapshot
+         */
+        void loadSnapshot(std::string snapshot_file);
+
         /**
          * @brief Write cached GTF data to BED format file
          * 
          * Converts the cached GTF/GFF data to BED format and writes to output file.
          * Creates a header with standard BED columns plus all attribute columns.
          * Coordinates are converted from 1-based (GTF) to 0-based (BED) for start position.
+         * With --sort the rows are ordered by (chr, start, end) in memory first.
          * 
          * @param sortedKeys Vector of sorted attribute keys for consistent column ordering
          */
         void writeToBed(std::vector<std::string>& sortedKeys);
+
+        /**
+         * @brief Send the BED rows of a streaming pass to the output, sorted with --sort
+         * 
+         * Without --sort the rows go straight to fdo. With it they go through a
+         * BedSorter that sorts in memory while the rows fit maxMemory and spills
+         * sorted runs to tempDir otherwise, then merges them into fdo.
+         * 
+         * @param fdo Output stream the header has already been written to
+         * @param rows Writes all BED rows to the stream it is given
+         */
+        void writeRows(std::ostream& fdo, const std::function<void(std::ostream&)>& rows);
+
+        /**
+         * @brief Check whether the input can be cached within the --sort memory budget
+         * 
+         * The estimate is about half the text size for the columnar cache, with
+         * compressed input assumed to inflate tenfold.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @return false if --sort is set and the cache would exceed maxMemory
+         */
+        bool cacheFitsMemory(const std::string& input_file) const;
+
+        /**
+         * @brief Index the rows written to a freshly opened output file (with --index)
+         * 
+         * @param fdo Output file, before anything has been written to it
+         */
+        void indexOutputFile(output_file& fdo);
+
+        /**
+         * @brief Save the index built while the output was written
+         * 
+         * Writes outFile.tbi, or outFile.csi if a row ends beyond 2^29. Needs
+         * the output to be closed, so that all block offsets are known.
+         * 
+         * @throws std::runtime_error via fail() if the output rows were not sorted
+         */
+        void writeIndex();
+
+        /**
+         * @brief Load the tabix/CSI index next to the input for a region query
+         * 
+         * With bgzipped input and an index named input_file.tbi or .csi, later
+         * reads only inflate the blocks that hold lines of the regions. Without
+         * one the whole input is read and other lines are skipped while parsing.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * 
+         * @throws std::runtime_error via fail() if the index cannot be read
+         */
+        void openInputIndex(const std::string& input_file);
+
+        /**
+         * @brief Restrict an opened input to the regions (if any were given)
+         * 
+         * @param gtf Input file, before it is iterated
+         */
+        void selectRegions(GTFFile& gtf) const;
+
+        /**
+         * @brief Index the cached (or snapshot) rows by chromosome and position
+         * 
+         * Fills intervals with the rows kept by cacheGTFFile() or loadSnapshot(),
+         * as 0-based half-open ranges, so that overlap and nearest-feature
+         * queries cost O(log n + hits) each.
+         */
+        void buildIntervalIndex();
+
+        /**
+         * @brief Annotate the positions of a BED or VCF file with the features overlapping them
+         * 
+         * Writes one row per overlapping feature: the position's chr, start, end and
+         * name, then the feature as writeToBed() writes it. A position without a hit
+         * gets one row with "." columns. Positions sorted by chromosome and start are
+         * answered in a single sweep; others fall back to tree queries. VCF input is
+         * recognised by a ##fileformat=VCF header or a .vcf name and spans its REF allele.
+         * 
+         * @param positions_file BED or VCF file of positions
+         * @param sortedKeys Attribute columns to write, in output order
+         * @param nearest Report the nearest feature (and a distance column) for positions without an overlap
+         * 
+         * @throws std::runtime_error via vrb.error() if the file cannot be read or has an invalid line
+         */
+        void annotatePositions(const std::string& positions_file, std::vector<std::string>& sortedKeys, bool nearest);
+
+        /**
+         * @brief Scan GTF/GFF file for attribute keys and feature types only
+         * 
+         * First pass of the streaming conversion. Collects the union of attribute
+         * keys and validates the requested feature types without caching any line,
+         * so memory scales with the number of distinct keys rather than file size.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * 
+         * @throws std::runtime_error if requested feature types are not found in file
+         */
+        void scanGTFFile(std::string input_file, FileFormat format_);
+
+        /**
+         * @brief Re-read GTF/GFF file and write each line straight to BED format
+         * 
+         * Second pass of the streaming conversion. Produces the same output as
+         * cacheGTFFile() followed by writeToBed(), one line at a time.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * @param sortedKeys Vector of sorted attribute keys for consistent column ordering
+         */
+        void streamToBed(std::string input_file, FileFormat format_, std::vector<std::string>& sortedKeys);
+
+        /**
+         * @brief Convert in a single pass using a fixed attribute column schema
+         * 
+         * Writes the header immediately and streams rows as they are parsed, so no
+         * key discovery pass is needed and memory stays constant.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * @param schemaKeys Attribute columns to write, in output order
+         * 
+         * @throws std::runtime_error if requested feature types are not found in file
+         */
+        void convertWithSchema(std::string input_file, FileFormat format_, std::vector<std::string>& schemaKeys);
+
+        /**
+         * @brief Check whether the input can be parsed in parallel chunks
+         * 
+         * Chunked parsing needs random access to the raw text, so it is only
+         * used with more than one thread on uncompressed input.
+         * 
+         * @param input_file Path to the input GTF/GFF/GFF3 file
+         * @return true if the parallel code path applies
+         */
+        bool useParallel(const std::string& input_file) const;
+
+        /**
+         * @brief Collect attribute keys and feature types with a pool of workers
+         * 
+         * Splits the memory-mapped input into newline-aligned chunks and merges
+         * the per-chunk key and feature sets.
+         * 
+         * @param input_file Path to the uncompressed input file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * @param filter Feature selection; receives every feature type seen in the file
+         */
+        void scanChunksParallel(std::string input_file, FileFormat format_, FeatureFilter& filter);
+
+        /**
+         * @brief Format BED rows with a pool of workers and write them in input order
+         * 
+         * Each newline-aligned chunk is converted into its own buffer; buffers are
+         * written in chunk order so the output is identical to the sequential path.
+         * 
+         * @param input_file Path to the uncompressed input file
+         * @param format_ File format (GTF, GFF, or GFF3)
+         * @param sortedKeys Attribute columns to write, in output order
+         * @param projection Attribute keys each worker's parser materialises, empty for all
+         * @param fdo Output stream the header has already been written to
+         * @param filter Feature selection; receives every feature type seen in the file
+         */
+        void writeChunksParallel(std::string input_file, FileFormat format_, const std::vector<std::string>& sortedKeys,
+                                 const std::vector<std::string>& projection, std::ostream& fdo, FeatureFilter& filter);
+
+        /**
+         * @brief Return the collected attribute keys in sorted order
+         * 
+         * With an attribute projection only the requested keys that occur in the
+         * input are returned.
+         * 
+         * @return Sorted vector of attribute keys, used as the BED column order
+         */
+        std::vector<std::string> sortedAttributeKeys() const;
+
+        /**
+         * @brief Attribute keys the parser has to materialise
+         * 
+         * @return attributeProjection plus gene_id (needed for the BED name), or empty to parse all keys
+         */
+        std::vector<std::string> parsedAttributes() const;
+
+        /**
+         * @brief Validate the requested feature types against those seen by a filter
+         * 
+         * @param filter Filter that has been run over the whole input
+         * 
+         * @throws std::runtime_error via vrb.error() if a requested feature type was not seen
+         *         (only a warning when the input is restricted to regions)
+         */
+        void checkFeatureTypes(const FeatureFilter& filter) const;
+
+        /**
+         * @brief Report an error that ends the conversion
+         * 
+         * Nothing reachable from runConversion() exits while batchJob is set.
+         * 
+         * @param message Error message
+         * 
+         * @throws std::runtime_error with message if batchJob is set, otherwise exits via vrb.error()
+         */
+        void fail(const std::string& message) const;
 };
 
 //--------------------------//
 //  FUNCTION DECLARATION   //
 //--------------------------//
 
+/**
+ * @struct BatchFile
+ * @brief One file of a batch conversion (several --input files or a --manifest)
+ */
+struct BatchFile {
+    std::string input;                 ///< Path to the GTF/GFF/GFF3 file
+    std::string output;                ///< Path to the BED file written
+    FileFormat format = FileFormat::GTF;
+    uint64_t bytes = 0;                ///< Input size on disk, the scheduling order
+    uint64_t reserved = 0;             ///< Bytes of the memory budget held while the file converts
+    bool streamed = false;             ///< Converted in two passes, its cache would not fit the budget
+    std::string mode;                  ///< Conversion path taken (see RunStats::mode)
+    double seconds = 0;                ///< Wall time of the conversion
+    uint64_t bytes_out = 0;
+    uint64_t lines_kept = 0;
+    uint64_t lines_filtered = 0;
+    std::string error;                 ///< Why the file failed, empty if it was converted
+};
+
+/**
+ * @brief Convert one input as configured on P
+ * 
+ * Picks the conversion path from the options: snapshot (--cache), annotation
+ * (--annotate), fixed schema (--columns), two passes (--streaming, threads on
+ * plain input, or a cache beyond --max-memory) or cached, then writes the
+ * index with --index.
+ * 
+ * @param P Converter with input_file, outFile and the options set
+ * @param format_ File format of the input
+ * @param schemaKeys Fixed attribute columns, empty to discover them
+ */
+void runConversion(GTF2Bed& P, FileFormat format_, std::vector<std::string>& schemaKeys);
+
+/**
+ * @brief Convert many files concurrently on one bounded thread pool
+ * 
+ * Files start largest first, so a big file does not run alone at the end.
+ * Each running file holds its estimated cache size of the settings.maxMemory
+ * budget, and a file only starts when its share is free; a file whose cache
+ * would not fit the whole budget is converted in two passes instead. The
+ * settings.threads threads are split between min(threads, files) files at a
+ * time. A file that fails is recorded in its BatchFile and the others go on.
+ * 
+ * @param settings Converter whose options and selections apply to every file
+ * @param files Files to convert; their results are filled in
+ * @param schemaKeys Fixed attribute columns, empty to discover them per file
+ */
+void convertBatch(const GTF2Bed& settings, std::vector<BatchFile>& files, const std::vector<std::string>& schemaKeys);
+
+/**
+ * @brief Read a batch manifest: one "input output [format]" row per file
+ * 
+ * Columns are separated by tabs or spaces; empty lines and lines starting with
+ * '#' are skipped. Rows without a format take default_format.
+ * 
+ * @param manifest_file Path to the manifest
+ * @param default_format Format of rows that do not name one, empty if there is none
+ * @return The files, in manifest order
+ * 
+ * @throws std::runtime_error via vrb.error() for a row without output or with an unknown or missing format
+ */
+std::vector<BatchFile> readManifest(const std::string& manifest_file, const std::string& default_format);
+
+/**
+ * @brief Print one line per batch file and the totals; write them as JSON if json_file is set
+ * 
+ * @param files Converted batch
+ * @param seconds Wall time of the whole batch
+ * @param json_file Path of the JSON summary (--stats-json), empty for none
+ * 
+ * @throws std::runtime_error via vrb.error() if a file failed, after the summary is written
+ */
+void reportBatch(const std::vector<BatchFile>& files, double seconds, const std::string& json_file);
+
 /**
  * @brief Main function for GTF to BED conversion
  * 
@@ -85,10 +423,27 @@ class GTF2Bed {
  * @param argv Vector of command line arguments
  * 
  * Command line options:
- * - --input, -i: Input GTF/GFF/GFF3 file (required)
- * - --output, -o: Output BED file (required)
- * - --format, -f: Input file format [GTF/GFF/GFF3] (required)
+ * - --input, -i: Input GTF/GFF/GFF3 file(s) (required unless --manifest is given)
+ * - --output, -o: Output BED file, or output directory for several inputs (required unless --manifest is given)
+ * - --format, -f: Input file format [GTF/GFF/GFF3] (required unless every manifest row names one)
+ * - --manifest: File of "input output [format]" rows, converted as one batch
  * - --feature-type, -t: Feature types to include (default: "all")
+ * - --streaming: Two-pass conversion without caching the input in memory
+ * - --columns: Fixed attribute columns, enables single-pass conversion
+ * - --schema-file: File listing the attribute columns, one per line
+ * - --attributes: Only parse and write these attribute keys
+ * - --threads: Number of worker threads (chunked parsing, or BGZF block inflation)
+ * - --cache: Binary .g2b snapshot of the parsed input, reused while the input is unchanged
+ * - --sort: Sort the output by chromosome, start and end
+ * - --max-memory: Memory for --sort rows before sorted runs are spilled to disk
+ * - --temp-dir: Directory for the --sort run files
+ * - --index: Write a tabix/CSI index next to bgzipped output (implies --sort)
+ * - --region: Only convert lines overlapping these regions (chr, chr:start or chr:start-end)
+ * - --regions-bed: Only convert lines overlapping the regions of a BED file
+ * - --annotate: Annotate the positions of a BED/VCF file with the features overlapping them
+ * - --nearest: With --annotate, report the nearest feature of positions without an overlap
+ * - --stats: Report time per phase, bytes in/out, lines/s, peak RSS and heap allocations (a batch always reports per file)
+ * - --stats-json: Also write the statistics as JSON to this file
  * - --help, -h: Show help message
  * - --log: Output log file
  * - --silent: Disable screen output
@@ -120,8 +475,9 @@ inline bool is_default_feature_type(const std::unordered_set<std::string>& s)
  * @param y Set of available feature types from input file
  * @return true if all elements in x are found in y, false otherwise
  */
+template <typename Set>
 inline bool is_present(const std::unordered_set<std::string>& x,
-                       const std::unordered_set<std::string>& y)
+                       const Set& y)
 {
     for (const std::string& x_item : x)
     {
@@ -133,4 +489,83 @@ inline bool is_present(const std::unordered_set<std::string>& x,
     return true; // All values found
 }
 
+/**
+ * @brief Check if a file is compressed (gzip, BGZF or bzip2)
+ * 
+ * Looks at the magic bytes rather than the extension, so a gzipped file
+ * without a .gz suffix is never memory-mapped as text.
+ * 
+ * @param filename File name to check
+ * @return true for gzip, BGZF or bzip2 content, false otherwise
+ */
+inline bool is_compressed_file(const std::string& filename)
+{
+    return detect_compression(filename) != Compression::NONE;
+}
+
+/**
+ * @brief Split a column list on commas and whitespace
+ * 
+ * Used for both --columns values and schema file lines, so that
+ * "gene_id,gene_name" and "gene_id gene_name" give the same schema.
+ * 
+ * @param item Column list to split
+ * @param columns Vector the non-empty column names are appended to
+ */
+inline void split_columns(const std::string& item, std::vector<std::string>& columns)
+{
+    std::vector<std::string> tokens;
+    boost::split(tokens, item, boost::is_any_of(", \t\r"), boost::token_compress_on);
+    for (std::string& token : tokens)
+    {
+        if (!token.empty()) columns.push_back(std::move(token));
+    }
+}
+
+/**
+ * @brief Read a --format value
+ * 
+ * @param name gtf, gff or gff3, in any case
+ * @return The file format
+ * 
+ * @throws std::runtime_error via vrb.error() for any other name
+ */
+inline FileFormat parse_format(const std::string& name)
+{
+    const std::string lower = boost::to_lower_copy(name);
+    if (lower == "gtf") return FileFormat::GTF;
+    if (lower == "gff") return FileFormat::GFF;
+    if (lower == "gff3") return FileFormat::GFF3;
+    vrb.error("Unknown file format [" + name + "]: use gtf, gff or gff3");
+    return FileFormat::GTF;
+}
+
+/**
+ * @brief Name of the BED file a batch input is written to
+ * 
+ * Drops the directory, a compression suffix and a GTF/GFF suffix, so that
+ * "dir/Mus_musculus.gtf.gz" becomes "Mus_musculus.bed".
+ * 
+ * @param input Path to the input file
+ * @param bgzip Name the output .bed.gz (for --index)
+ * @return File name of the output, without directory
+ */
+inline std::string batch_output_name(const std::string& input, bool bgzip)
+{
+    std::string name = std::filesystem::path(input).filename().string();
+    for (const char* suffix : {".gz", ".bgz", ".bz2"}) {
+        if (boost::iends_with(name, suffix)) {
+            name.resize(name.size() - std::strlen(suffix));
+            break;
+        }
+    }
+    for (const char* suffix : {".gtf", ".gff3", ".gff"}) {
+        if (boost::iends_with(name, suffix)) {
+            name.resize(name.size() - std::strlen(suffix));
+            break;
+        }
+    }
+    return name + (bgzip ? ".bed.gz" : ".bed");
+}
+
 #endif 
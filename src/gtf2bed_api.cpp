@@ -0,0 +1,218 @@
+#include "gtf2bed_api.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "../lib/Arena.hpp"
+#include "../lib/BedWriter.hpp"
+#include "../lib/GTFIterator.hpp"
+#include "../lib/RegionSet.hpp"
+#include "../lib/TabixReader.hpp"
+
+namespace gtf2bed {
+
+namespace {
+
+FileFormat file_format(Format format)
+{
+    switch (format) {
+        case Format::GFF: return FileFormat::GFF;
+        case Format::GFF3: return FileFormat::GFF3;
+        default: return FileFormat::GTF;
+    }
+}
+
+RegionSet parse_regions(const std::vector<std::string>& texts)
+{
+    RegionSet regions;
+    for (const std::string& text : texts) regions.add(GenomicRegion::parse(text));
+    return regions;
+}
+
+/**
+ * @brief One pass of the parser with the options' selection; fn(line) returns false to stop
+ */
+template <typename Fn>
+Summary parse(const std::string& input_file, const Options& options, Fn&& fn)
+{
+    if (!std::filesystem::is_regular_file(input_file)) throw std::runtime_error("Cannot open input file: " + input_file);
+
+    const RegionSet regions = parse_regions(options.regions);
+    FeatureFilter filter(std::unordered_set<std::string>(options.feature_types.begin(), options.feature_types.end()));
+    GTFFile gtf(input_file, file_format(options.format), std::max(1u, options.threads));
+    gtf.set_filter(&filter);
+    gtf.set_projection(options.attributes);
+    if (!regions.empty()) {
+        gtf.set_regions(&regions);
+        const std::string index_file = options.use_index && gtf.compression() == Compression::BGZF
+                                     ? TabixReader::find_for(input_file) : std::string();
+        if (!index_file.empty()) gtf.read_chunks(TabixReader(index_file).chunks(regions));
+    }
+
+    // Keys are collected by interned id, so known keys cost one lookup per attribute
+    Summary summary;
+    std::vector<char> seen;
+    for (const GTFLineView& line : gtf) {
+        summary.records++;
+        for (const GTFAttribute& attr : line.attributes) {
+            if (attr.id >= seen.size()) seen.resize(attr.id + 1, 0);
+            if (!seen[attr.id]) {
+                seen[attr.id] = 1;
+                summary.attribute_keys.emplace_back(attr.key);
+            }
+        }
+        if (!fn(line)) break;
+    }
+    summary.filtered = filter.rejected();
+    summary.feature_types.assign(filter.seen().begin(), filter.seen().end());
+    std::sort(summary.feature_types.begin(), summary.feature_types.end());
+    std::sort(summary.attribute_keys.begin(), summary.attribute_keys.end());
+    return summary;
+}
+
+// Record over a parsed line; attributes is the caller's buffer for the attribute list
+Record view_record(const GTFLineView& line, std::vector<Attribute>& attributes)
+{
+    attributes.clear();
+    for (const GTFAttribute& attr : line.attributes) attributes.push_back({attr.key, attr.value});
+    return {line.seqname, line.source, line.feature, line.start, line.end,
+            line.score, line.strand, line.frame, std::span<const Attribute>(attributes)};
+}
+
+// Record that owns its text in arena
+Record copy_record(const GTFLineView& line, Arena& arena)
+{
+    Attribute* attributes = arena.allocate_array<Attribute>(line.attributes.size());
+    for (std::size_t i = 0; i < line.attributes.size(); ++i) {
+        attributes[i] = {arena.copy(line.attributes[i].key), arena.copy(line.attributes[i].value)};
+    }
+    return {arena.copy(line.seqname), arena.copy(line.source), arena.copy(line.feature), line.start, line.end,
+            arena.copy(line.score), line.strand, arena.copy(line.frame),
+            std::span<const Attribute>(attributes, line.attributes.size())};
+}
+
+} // namespace
+
+const std::string_view* Record::find(std::string_view key) const
+{
+    for (auto it = attributes.rbegin(); it != attributes.rend(); ++it) {
+        if (it->key == key) return &it->value;
+    }
+    return nullptr;
+}
+
+//--------------//
+//    READER    //
+//--------------//
+
+Reader::Reader(std::string input_file, Options options)
+    : input_file_(std::move(input_file)), options_(std::move(options))
+{
+    parse_regions(options_.regions); // reports a bad region before any pass
+}
+
+Summary Reader::read(const std::function<bool(const Record&)>& visit) const
+{
+    std::vector<Attribute> attributes;
+    return parse(input_file_, options_, [&](const GTFLineView& line) { return visit(view_record(line, attributes)); });
+}
+
+Summary Reader::read(std::size_t batch_size, const std::function<bool(const Batch&)>& visit) const
+{
+    batch_size = std::max<std::size_t>(1, batch_size);
+    std::shared_ptr<Arena> arena;
+    std::shared_ptr<std::vector<Record>> records;
+    auto start_batch = [&] {
+        arena = std::make_shared<Arena>();
+        records = std::make_shared<std::vector<Record>>();
+        records->reserve(batch_size);
+    };
+
+    // The batch takes the arena and records along; the next one starts on fresh ones
+    bool more = true;
+    auto hand_on = [&] {
+        Batch batch;
+        batch.text_ = std::move(arena);
+        batch.records_ = std::move(records);
+        more = visit(batch);
+        start_batch();
+    };
+    start_batch();
+    Summary summary = parse(input_file_, options_, [&](const GTFLineView& line) {
+        records->push_back(copy_record(line, *arena));
+        if (records->size() == batch_size) hand_on();
+        return more;
+    });
+    if (more && !records->empty()) hand_on();
+    return summary;
+}
+
+//------------------//
+//  BED FORMATTER   //
+//------------------//
+
+BedFormatter::BedFormatter(std::vector<std::string> columns) : columns_(std::move(columns)) {}
+
+// Same header and rows as the tool: both are written by BedWriter.hpp
+std::string BedFormatter::header() const
+{
+    std::ostringstream header;
+    write_bed_header(header, columns_);
+    return header.str();
+}
+
+void BedFormatter::append(const Record& record, std::string& out) const
+{
+    static const std::string gene_id = "gene_id";
+    BedWriter bed(std::move(out));
+    try {
+        write_bed_row(bed, record, gene_id, columns_, [](const Record& r, const std::string& key) { return r.find(key); });
+    } catch (...) {
+        out = bed.take();
+        throw;
+    }
+    out = bed.take();
+}
+
+//--------------//
+//   CONVERT    //
+//--------------//
+
+Summary convert(const std::string& input_file, std::ostream& out, const Options& options)
+{
+    // The BED name needs gene_id even when it is not one of the requested attributes
+    Options parsing = options;
+    if (!parsing.attributes.empty() && std::find(parsing.attributes.begin(), parsing.attributes.end(), "gene_id") == parsing.attributes.end()) {
+        parsing.attributes.push_back("gene_id");
+    }
+    const Reader reader(input_file, parsing);
+
+    // Columns: the keys found, restricted to the requested attributes
+    std::vector<std::string> columns = reader.read([](const Record&) { return true; }).attribute_keys;
+    if (!options.attributes.empty()) {
+        std::erase_if(columns, [&](const std::string& key) {
+            return std::find(options.attributes.begin(), options.attributes.end(), key) == options.attributes.end();
+        });
+    }
+    const BedFormatter formatter(std::move(columns));
+
+    out << formatter.header();
+    std::string buffer;
+    Summary summary = reader.read([&](const Record& record) {
+        formatter.append(record, buffer);
+        if (buffer.size() >= (1 << 16)) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        return true;
+    });
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!out) throw std::runtime_error("Error while writing the BED output");
+    return summary;
+}
+
+} // namespace gtf2bed
@@ -0,0 +1,219 @@
+#ifndef GTF2BED_API_HPP
+#define GTF2BED_API_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * @namespace gtf2bed
+ * @brief Embeddable interface of libgtf2bed
+ *
+ * Reads GTF/GFF/GFF3 files with the parser, feature filter and region
+ * selection of the command line tool and pushes the records to a callback,
+ * one at a time or in batches, so a pipeline can use them without writing
+ * BED to disk and parsing it back. BedFormatter writes the rows the tool
+ * writes. Nothing here prints, exits or touches the tool's global logger:
+ * errors are thrown as std::runtime_error (std::invalid_argument for bad
+ * options).
+ *
+ * This header only needs the standard library; the parser headers stay
+ * private to the library.
+ */
+namespace gtf2bed {
+
+/**
+ * @brief Input file format
+ */
+enum class Format {
+    GTF,
+    GFF,
+    GFF3
+};
+
+/**
+ * @brief One attribute of a record
+ */
+struct Attribute {
+    std::string_view key;
+    std::string_view value;
+};
+
+/**
+ * @brief One parsed line of the input
+ *
+ * Coordinates are those of the file: 1-based, end included. The views point
+ * into the reader's buffers. Records passed one at a time are only valid
+ * during the callback; records of a batch stay valid until the callback
+ * returns. Copy what has to be kept.
+ */
+struct Record {
+    std::string_view seqname;
+    std::string_view source;
+    std::string_view feature;
+    int64_t start = 0;
+    int64_t end = 0;
+    std::string_view score;
+    char strand = '.';
+    std::string_view frame;
+    std::span<const Attribute> attributes;   ///< In file order; keys left out by Options::attributes are absent
+
+    /**
+     * @brief Look up an attribute
+     *
+     * @param key Attribute key
+     * @return The value, or nullptr; a key given twice returns its last value
+     */
+    const std::string_view* find(std::string_view key) const;
+};
+
+/**
+ * @class Batch
+ * @brief Records that own their text
+ *
+ * Copies share the records and their text, so a batch can be kept or handed
+ * on (e.g. to another thread) after the callback returns; it stays valid as
+ * long as one copy of it exists. Copying a batch copies two pointers.
+ */
+class Batch {
+    public:
+        std::span<const Record> records() const { return records_ ? std::span<const Record>(*records_) : std::span<const Record>(); }
+        std::size_t size() const { return records().size(); }
+        bool empty() const { return records().empty(); }
+        const Record& operator[](std::size_t i) const { return (*records_)[i]; }
+        auto begin() const { return records().begin(); }
+        auto end() const { return records().end(); }
+
+    private:
+        friend class Reader;
+        std::shared_ptr<const void> text_;                   ///< Arena the views of the records point into
+        std::shared_ptr<const std::vector<Record>> records_;
+};
+
+/**
+ * @brief What a Reader reads
+ */
+struct Options {
+    Format format = Format::GTF;
+    std::vector<std::string> feature_types;  ///< Only records of these feature types; empty (or "all") keeps every one
+    std::vector<std::string> attributes;     ///< Only parse these attribute keys; empty parses all of them
+    std::vector<std::string> regions;        ///< Only records overlapping these regions ("chr", "chr:start-end", 1-based); empty reads all
+    unsigned int threads = 1;                ///< Threads inflating BGZF input
+    bool use_index = true;                   ///< Read bgzipped input with regions through its .tbi/.csi index, if it has one
+};
+
+/**
+ * @brief What a pass over the input saw
+ */
+struct Summary {
+    uint64_t records = 0;                    ///< Records passed to the callback
+    uint64_t filtered = 0;                   ///< Records dropped by the feature type selection
+    std::vector<std::string> feature_types;  ///< Every feature type seen (also the dropped ones), sorted
+    std::vector<std::string> attribute_keys; ///< Every attribute key of the records passed on, sorted
+};
+
+/**
+ * @class Reader
+ * @brief Pushes the records of a GTF/GFF/GFF3 file to a callback
+ *
+ * Each call to read() is a fresh pass over the input, so one Reader can
+ * collect the attribute keys first and hand out the records second. The
+ * input may be plain, gzip, bzip2 or BGZF compressed.
+ */
+class Reader {
+    public:
+        /**
+         * @brief Prepare a reader; the file is opened by each read()
+         *
+         * @param input_file Path to the GTF/GFF/GFF3 file
+         * @param options Format and selection
+         *
+         * @throws std::invalid_argument if a region cannot be parsed
+         */
+        explicit Reader(std::string input_file, Options options = {});
+
+        /**
+         * @brief Call visit for every selected record, in file order
+         *
+         * @param visit Receives each record; returning false stops the pass
+         * @return What the pass saw, up to where it stopped
+         *
+         * @throws std::runtime_error if the file cannot be opened or read
+         */
+        Summary read(const std::function<bool(const Record&)>& visit) const;
+
+        /**
+         * @brief Call visit with batches of up to batch_size records, in file order
+         *
+         * Each batch owns its records: a copy of it made in the callback
+         * stays valid after the callback and the pass have returned.
+         *
+         * @param batch_size Records per batch (at least 1); the last batch may be shorter
+         * @param visit Receives each batch; returning false stops the pass
+         * @return What the pass saw, up to where it stopped
+         *
+         * @throws std::runtime_error if the file cannot be opened or read
+         */
+        Summary read(std::size_t batch_size, const std::function<bool(const Batch&)>& visit) const;
+
+    private:
+        std::string input_file_;
+        Options options_;
+};
+
+/**
+ * @class BedFormatter
+ * @brief Formats records as the BED rows of the command line tool
+ *
+ * Columns are chr, start (0-based), end, gene_id, feature type and score,
+ * then one column per attribute key given, with "." where a record lacks it.
+ */
+class BedFormatter {
+    public:
+        /**
+         * @param columns Attribute keys written after the six standard columns, in this order
+         */
+        explicit BedFormatter(std::vector<std::string> columns);
+
+        /**
+         * @brief The header line, "\n" included
+         */
+        std::string header() const;
+
+        /**
+         * @brief Append the BED row of a record, "\n" included, to out
+         *
+         * @throws std::out_of_range if the record has no gene_id attribute
+         */
+        void append(const Record& record, std::string& out) const;
+
+        const std::vector<std::string>& columns() const { return columns_; }
+
+    private:
+        std::vector<std::string> columns_;
+};
+
+/**
+ * @brief Convert a file to BED on a stream, as the command line tool does
+ *
+ * Two passes: the first collects the attribute keys that become the
+ * columns, the second formats the rows. Unlike the tool, requested feature
+ * types that do not occur are not an error; check Summary::feature_types.
+ *
+ * @param input_file Path to the GTF/GFF/GFF3 file
+ * @param out Stream the header and rows are written to
+ * @param options Format and selection
+ * @return Summary of the second pass
+ *
+ * @throws std::runtime_error if the file cannot be read; std::out_of_range for a record without gene_id
+ */
+Summary convert(const std::string& input_file, std::ostream& out, const Options& options = {});
+
+} // namespace gtf2bed
+
+#endif // GTF2BED_API_HPP
@@ -4,6 +4,18 @@
 
 #include "gtf2bed.hpp"
 #include <iostream>
+#include <cstdlib>
+#include <new>
+
+// Heap allocation counter reported by --stats: one relaxed increment per allocation
+void* operator new(std::size_t size) {
+    run_stats::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
 
 /**
  * @brief Main entry point for GTF2BED application
@@ -23,6 +35,7 @@
  * @return 0 on success, exits with error code on failure
  */
 int main(int argc, char** argv) {
+    run_stats::allocations_counted = true;
     
     // Display application banner with ASCII art
     std::cout << "\x1B[35;1m" << R"(
@@ -3,11 +3,30 @@
 #include "../lib/ntools.hpp"
 #include "../src/gtf2bed.hpp"
 #include "../src/gtf2bed.cpp"
+#include "../src/gtf2bed_api.hpp"
+#include "../lib/SyntheticAnnotation.hpp"
 #include <iomanip>
 #include <openssl/sha.h>  // make sure OpenSSL is installed and linked
 
 #include <fstream>
 #include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <random>
+
+
+// Counts every heap allocation made by the test binary
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
 
 
 std::string sha256_of_file(const std::string& filename) {
@@ -182,4 +201,1558 @@ TEST(GTF2BedTest, WriteToBedMatchesGoldenFile) {
     EXPECT_EQ(outputHash, goldenHash);
 
     std::remove(outputFile.c_str());
-}
\ No newline at end of file
+}
+
+// ---------- TESTS FOR GTFParser ---------- //
+
+TEST(GTF2BedTest, ParserSplitsGTFLineIntoViews) {
+    GTFParser parser(FileFormat::GTF);
+    GTFLineView view;
+    parser.parse_line("chr1\tHAVANA\texon\t100\t200\t.\t-\t0\tgene_id \"g1\"; transcript_id \"t1\"; exon_number 2;", view);
+
+    EXPECT_EQ(view.seqname, "chr1");
+    EXPECT_EQ(view.feature, "exon");
+    EXPECT_EQ(view.start, 100);
+    EXPECT_EQ(view.end, 200);
+    EXPECT_EQ(view.strand, '-');
+    EXPECT_EQ(view.frame, "0");
+    ASSERT_EQ(view.attributes.size(), 3u);
+    EXPECT_EQ(*view.find("gene_id"), "g1");
+    EXPECT_EQ(*view.find("exon_number"), "2");
+    EXPECT_EQ(view.find("gene_name"), nullptr);
+
+    GTFLine line = view.to_line();
+    EXPECT_EQ(line.attributes.at("transcript_id"), "t1");
+    EXPECT_EQ(line.start, 100);
+}
+
+TEST(GTF2BedTest, ParserDecodesGFF3Values) {
+    GTFParser parser(FileFormat::GFF3);
+    GTFLineView view;
+    parser.parse_line("chr1\tsrc\tgene\t1\t10\t.\t+\t.\tID=g1; Note=a%20b%3Dc ;gene_id=g1\r", view);
+
+    EXPECT_EQ(*view.find("ID"), "g1");
+    EXPECT_EQ(*view.find("Note"), "a b=c");
+    EXPECT_EQ(*view.find("gene_id"), "g1");
+}
+
+// The decoder this project started with, kept as the reference for escape handling
+static std::string reference_url_decode(const std::string& str) {
+    std::string result;
+    for (size_t i = 0; i < str.length(); ++i) {
+        if (str[i] == '%' && i + 2 < str.length()) {
+            int value;
+            std::istringstream hex_stream(str.substr(i + 1, 2));
+            if (hex_stream >> std::hex >> value) {
+                result += static_cast<char>(value);
+                i += 2;
+            } else {
+                result += str[i];
+            }
+        } else {
+            result += str[i];
+        }
+    }
+    return result;
+}
+
+TEST(GTF2BedTests, UrlDecode_MatchesReferenceForEveryEscape) {
+    for (int a = 0; a < 256; ++a) {
+        for (int b = 0; b < 256; ++b) {
+            std::string value = "x%";
+            value += static_cast<char>(a);
+            value += static_cast<char>(b);
+            value += "y";
+            std::string decoded;
+            GTFParser::decode_into(decoded, value);
+            ASSERT_EQ(decoded, reference_url_decode(value)) << "escape bytes " << a << " " << b;
+        }
+    }
+    for (const std::string value : {"", "plain", "%", "%4", "a%41", "%41%42%", "%%41", "100%"}) {
+        std::string decoded;
+        GTFParser::decode_into(decoded, value);
+        EXPECT_EQ(decoded, reference_url_decode(value)) << value;
+    }
+}
+
+TEST(GTF2BedTest, ParserProjectionSkipsOtherKeys) {
+    GTFParser parser(FileFormat::GFF3);
+    parser.project({"Note", "gene_id"});
+    GTFLineView view;
+    parser.parse_line("chr1\tsrc\tgene\t1\t10\t.\t+\t.\tID=g1;Note=a%20b;Alias=x%3By;gene_id=g1", view);
+
+    ASSERT_EQ(view.attributes.size(), 2u);
+    EXPECT_EQ(*view.find("Note"), "a b");
+    EXPECT_EQ(*view.find("gene_id"), "g1");
+    EXPECT_EQ(view.find("Alias"), nullptr);
+
+    // Skipped keys can still be read from the raw column
+    std::string value;
+    EXPECT_TRUE(parser.find_unparsed(view, "Alias", value));
+    EXPECT_EQ(value, "x;y");
+    EXPECT_FALSE(parser.find_unparsed(view, "Name", value));
+}
+
+TEST(GTF2BedTest, AttributeProjectionKeepsRequestedColumns) {
+    std::string input_file = "../data/example.gtf";
+
+    GTF2Bed cached;
+    cached.featureTypes = {"all"};
+    cached.attributeProjection = {"transcript_id", "gene_name", "no_such_key"};
+    cached.outFile = "test_output_projected_cached.bed";
+    cached.cacheGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> cachedKeys = cached.sortedAttributeKeys();
+    EXPECT_EQ(cachedKeys, (std::vector<std::string>{"gene_name", "transcript_id"}));
+    cached.writeToBed(cachedKeys);
+
+    GTF2Bed parallel;
+    parallel.featureTypes = {"all"};
+    parallel.attributeProjection = cached.attributeProjection;
+    parallel.threads = 4;
+    parallel.outFile = "test_output_projected_parallel.bed";
+    parallel.scanGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> parallelKeys = parallel.sortedAttributeKeys();
+    EXPECT_EQ(cachedKeys, parallelKeys);
+    parallel.streamToBed(input_file, FileFormat::GTF, parallelKeys);
+
+    EXPECT_EQ(sha256_of_file(cached.outFile), sha256_of_file(parallel.outFile));
+
+    std::ifstream bed(cached.outFile);
+    std::string header;
+    std::getline(bed, header);
+    EXPECT_EQ(header, "#chr\tstart\tend\tid\tinfo\tstrand\tgene_name\ttranscript_id");
+
+    std::remove(cached.outFile.c_str());
+    std::remove(parallel.outFile.c_str());
+}
+
+
+TEST(GTF2BedTest, StreamToBedMatchesGoldenFile) {
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+
+    std::string input_file = "../data/example.gtf";
+    converter.scanGTFFile(input_file, FileFormat::GTF);
+
+    // Streaming mode never caches lines
+    EXPECT_TRUE(converter.cachedFile.empty());
+
+    std::string outputFile = "test_output_streaming.bed";
+    converter.outFile = outputFile;
+
+    std::vector<std::string> sortedKeys = converter.sortedAttributeKeys();
+    converter.streamToBed(input_file, FileFormat::GTF, sortedKeys);
+
+    EXPECT_EQ(sha256_of_file(outputFile), sha256_of_file("../tests/expected_output.bed"));
+
+    std::remove(outputFile.c_str());
+}
+
+
+// ---------- TESTS FOR split_columns ---------- //
+
+TEST(GTF2BedTests, SplitColumns_CommasAndSpaces) {
+    std::vector<std::string> columns;
+    split_columns("gene_id,transcript_id gene_name,,", columns);
+    split_columns("  gene_type\r", columns);
+    std::vector<std::string> expected = {"gene_id", "transcript_id", "gene_name", "gene_type"};
+    EXPECT_EQ(columns, expected);
+}
+
+TEST(GTF2BedTest, ConvertWithSchemaWritesFixedColumns) {
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+
+    std::string outputFile = "test_output_schema.bed";
+    converter.outFile = outputFile;
+
+    std::vector<std::string> schemaKeys = {"transcript_id", "gene_name", "missing_key"};
+    converter.convertWithSchema("../data/test.gff3", FileFormat::GFF3, schemaKeys);
+
+    std::ifstream infile(outputFile);
+    std::string header, first;
+    std::getline(infile, header);
+    std::getline(infile, first);
+
+    EXPECT_EQ(header, "#chr\tstart\tend\tid\tinfo\tstrand\ttranscript_id\tgene_name\tmissing_key");
+    EXPECT_EQ(first, "chr1\t3143475\t3144545\tENSMUSG00000102693.2\tgene\t.\t.\t4933401J01Rik\t.");
+
+    std::remove(outputFile.c_str());
+}
+
+
+// ---------- TESTS FOR PARALLEL CHUNKED PARSING ---------- //
+
+TEST(GTF2BedTests, NewlineAlignedChunks_CoverInputOnLineBoundaries) {
+    std::string data = "a\nbb\nccc\ndddd\neeeee";
+    auto chunks = newline_aligned_chunks(data, 3);
+
+    ASSERT_FALSE(chunks.empty());
+    EXPECT_EQ(chunks.front().first, 0u);
+    EXPECT_EQ(chunks.back().second, data.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (i > 0) {
+            EXPECT_EQ(chunks[i].first, chunks[i - 1].second);
+        }
+        if (chunks[i].second < data.size()) {
+            EXPECT_EQ(data[chunks[i].second - 1], '\n');
+        }
+    }
+}
+
+TEST(GTF2BedTest, ParallelConversionMatchesGoldenFile) {
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+    converter.threads = 4;
+
+    std::string input_file = "../data/example.gtf";
+    ASSERT_TRUE(converter.useParallel(input_file));
+    converter.scanGTFFile(input_file, FileFormat::GTF);
+    EXPECT_EQ(converter.linecount, 10000u);
+
+    std::string outputFile = "test_output_parallel.bed";
+    converter.outFile = outputFile;
+
+    std::vector<std::string> sortedKeys = converter.sortedAttributeKeys();
+    converter.streamToBed(input_file, FileFormat::GTF, sortedKeys);
+
+    EXPECT_EQ(sha256_of_file(outputFile), sha256_of_file("../tests/expected_output.bed"));
+
+    std::remove(outputFile.c_str());
+}
+
+
+// ---------- TESTS FOR THE SIMD TOKENIZER ---------- //
+
+// Runs every scanner the CPU supports over s and checks it against the scalar one
+static void expect_scanners_agree(std::string_view s, SeparatorSet set, std::size_t max = SIZE_MAX) {
+    std::vector<uint32_t> expected;
+    tokenizer::scan_scalar(s, set, expected, max);
+    for (tokenizer::Level level : {tokenizer::Level::SSE2, tokenizer::Level::AVX2}) {
+        if (level > tokenizer::detect_level()) continue;
+        std::vector<uint32_t> found;
+        tokenizer::scan_function(level)(s, set, found, max);
+        ASSERT_EQ(found, expected) << "level " << static_cast<int>(level) << " on: " << s;
+    }
+}
+
+TEST(GTF2BedTests, Tokenizer_SIMDMatchesScalarOnDataFiles) {
+    for (const char* file : {"../data/example.gtf", "../data/test.gff", "../data/test.gff3"}) {
+        std::ifstream in(file);
+        ASSERT_TRUE(in.is_open()) << file;
+        std::string line;
+        while (std::getline(in, line)) {
+            expect_scanners_agree(line, '\t', 8);
+            expect_scanners_agree(line, SeparatorSet(';', '"'));
+            expect_scanners_agree(line, SeparatorSet(';', '='));
+        }
+    }
+}
+
+TEST(GTF2BedTests, Tokenizer_SIMDMatchesScalarOnRandomLines) {
+    const std::string alphabet = "ab \t;=\"%\r\n\x80\xff";
+    std::mt19937 rng(42);
+    for (int i = 0; i < 5000; ++i) {
+        std::string line(rng() % 300, ' ');
+        for (char& c : line) c = alphabet[rng() % alphabet.size()];
+        // Unaligned starts exercise the block loop and the scalar tail
+        std::string_view view = std::string_view(line).substr(std::min<std::size_t>(rng() % 7, line.size()));
+        expect_scanners_agree(view, SeparatorSet(';', '"'));
+        expect_scanners_agree(view, SeparatorSet('\t', ';', '=', '%'), rng() % 20);
+    }
+}
+
+TEST(GTF2BedTests, Tokenizer_FindsSeparatorsInOrder) {
+    std::vector<uint32_t> found;
+    find_separators("a;b=\"c\";", SeparatorSet(';', '"'), found);
+    EXPECT_EQ(found, (std::vector<uint32_t>{1, 4, 6, 7}));
+
+    std::string fields(100, 'x');
+    fields[10] = fields[70] = fields[99] = '\t';
+    found.clear();
+    find_separators(fields, '\t', found, 2);
+    EXPECT_EQ(found, (std::vector<uint32_t>{10, 70}));
+}
+
+
+// ---------- TESTS FOR FEATURE FILTERING ---------- //
+
+TEST(GTF2BedTests, FeatureFilter_RejectsUnselectedAndRecordsSeen) {
+    FeatureFilter filter(std::unordered_set<std::string>{"gene"});
+    EXPECT_TRUE(filter.accept("gene"));
+    EXPECT_FALSE(filter.accept("exon"));
+    EXPECT_FALSE(filter.accept("exon"));
+    EXPECT_EQ(filter.kept(), 1u);
+    EXPECT_EQ(filter.rejected(), 2u);
+    EXPECT_EQ(filter.seen().size(), 2u);
+
+    FeatureFilter all(std::unordered_set<std::string>{"all"});
+    EXPECT_TRUE(all.accepts_all());
+    EXPECT_TRUE(all.accept("exon"));
+
+    GTFParser parser(FileFormat::GTF, &filter);
+    GTFLineView line;
+    EXPECT_FALSE(parser.parse_line("chr1\tsrc\texon\t1\t2\t.\t+\t.\tgene_id \"g1\";", line));
+    EXPECT_TRUE(line.attributes.empty());
+    EXPECT_TRUE(parser.parse_line("chr1\tsrc\tgene\t1\t2\t.\t+\t.\tgene_id \"g1\";", line));
+    EXPECT_EQ(line.attributes.size(), 1u);
+}
+
+TEST(GTF2BedTest, CacheGTFFileKeepsOnlySelectedFeatures) {
+    GTF2Bed converter;
+    converter.featureTypes = {"gene"};
+    converter.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+
+    ASSERT_EQ(converter.cachedFile.size(), 298u);
+    for (const GTFRecord& record : converter.cachedFile) {
+        EXPECT_EQ(record.feature, "gene");
+    }
+    // Keys that only occur on other feature types do not become columns
+    EXPECT_EQ(converter.attribute_keys.count("gene_name"), 1u);
+    EXPECT_EQ(converter.attribute_keys.count("transcript_id"), 0u);
+    EXPECT_EQ(converter.attribute_keys.count("exon_number"), 0u);
+}
+
+TEST(GTF2BedTest, FilteredOutputIsTheSameOnAllPaths) {
+    std::string input_file = "../data/example.gtf";
+
+    GTF2Bed cached;
+    cached.featureTypes = {"exon", "CDS"};
+    cached.outFile = "test_output_filtered_cached.bed";
+    cached.cacheGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> cachedKeys = cached.sortedAttributeKeys();
+    cached.writeToBed(cachedKeys);
+
+    GTF2Bed parallel;
+    parallel.featureTypes = {"exon", "CDS"};
+    parallel.threads = 4;
+    parallel.outFile = "test_output_filtered_parallel.bed";
+    parallel.scanGTFFile(input_file, FileFormat::GTF);
+    EXPECT_EQ(parallel.linecount, 4265u + 4177u);
+    std::vector<std::string> parallelKeys = parallel.sortedAttributeKeys();
+    parallel.streamToBed(input_file, FileFormat::GTF, parallelKeys);
+
+    EXPECT_EQ(cachedKeys, parallelKeys);
+    EXPECT_EQ(sha256_of_file(cached.outFile), sha256_of_file(parallel.outFile));
+
+    std::ifstream bed(cached.outFile);
+    std::string row;
+    std::getline(bed, row); // header
+    std::size_t rows = 0;
+    while (std::getline(bed, row)) rows++;
+    EXPECT_EQ(rows, 4265u + 4177u);
+
+    std::remove(cached.outFile.c_str());
+    std::remove(parallel.outFile.c_str());
+}
+
+
+// ---------- TESTS FOR COMPRESSED INPUT ---------- //
+
+TEST(GTF2BedTest, GzipInputIsDecompressed) {
+    std::string gzFile = "test_input.gff3.gz";
+    {
+        std::ifstream plain("../data/test.gff3");
+        std::ofstream raw(gzFile, std::ios::binary);
+        boost::iostreams::filtering_ostream fdo;
+        fdo.push(boost::iostreams::gzip_compressor());
+        fdo.push(raw);
+        fdo << plain.rdbuf();
+    }
+    EXPECT_EQ(detect_compression(gzFile), Compression::GZIP);
+    EXPECT_EQ(detect_compression("../data/test.gff3"), Compression::NONE);
+
+    size_t plainLines = 0, gzLines = 0;
+    GTFFile plain("../data/test.gff3", FileFormat::GFF3);
+    for (const GTFLineView& line : plain) plainLines += !line.seqname.empty();
+    GTFFile gz(gzFile, FileFormat::GFF3);
+    for (const GTFLineView& line : gz) gzLines += (line.seqname == "chr1");
+
+    EXPECT_GT(plainLines, 0u);
+    EXPECT_EQ(gzLines, plainLines);
+
+    std::remove(gzFile.c_str());
+}
+
+TEST(GTF2BedTest, BgzfOutputRoundTrips) {
+    std::string input_file = "../data/example.gtf";
+    std::string bgzFile = "test_output.bed.gz";
+
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+    converter.threads = 3;
+    converter.outFile = bgzFile;
+    converter.scanGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> sortedKeys = converter.sortedAttributeKeys();
+    converter.streamToBed(input_file, FileFormat::GTF, sortedKeys);
+
+    ASSERT_EQ(detect_compression(bgzFile), Compression::BGZF);
+
+    // Every member is a BGZF block of at most 64 KB, and the file ends with the EOF block
+    std::ifstream raw(bgzFile, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+    size_t pos = 0, blocks = 0;
+    while (pos < bytes.size()) {
+        size_t size = bgzf::block_size(reinterpret_cast<const unsigned char*>(bytes.data() + pos), bytes.size() - pos);
+        ASSERT_GT(size, 0u);
+        ASSERT_LE(size, bgzf::max_block_size);
+        pos += size;
+        blocks++;
+    }
+    EXPECT_GT(blocks, 2u);
+    EXPECT_EQ(bytes.substr(bytes.size() - sizeof(bgzf::eof_block)),
+              std::string(reinterpret_cast<const char*>(bgzf::eof_block), sizeof(bgzf::eof_block)));
+
+    // Parallel inflate gives back the golden file
+    BGZFReader reader(bgzFile, 4);
+    std::string inflated;
+    char buffer[10000];
+    std::streamsize n;
+    while ((n = reader.read(buffer, sizeof(buffer))) > 0) inflated.append(buffer, n);
+
+    std::ifstream golden("../tests/expected_output.bed", std::ios::binary);
+    std::string expected((std::istreambuf_iterator<char>(golden)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(inflated, expected);
+
+    std::remove(bgzFile.c_str());
+}
+
+
+
+// ---------- TESTS FOR COLUMNAR, ARENA-BACKED CACHE ---------- //
+
+TEST(GTF2BedTest, CacheGTFFileAllocatesAlmostNothingPerLine) {
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+
+    size_t before = g_allocations.load();
+    converter.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+    size_t allocations = g_allocations.load() - before;
+
+    ASSERT_EQ(converter.cachedFile.size(), 10000u);
+    // Reader buffer, arena chunks, amortised column growth, new keys and progress messages only
+    EXPECT_LT(allocations, converter.cachedFile.size() / 10);
+
+    // Rows materialise from the columns with their original values
+    const GTFRecord& first = converter.cachedFile[0];
+    EXPECT_EQ(first.seqname, "000000F");
+    EXPECT_EQ(first.start, 163);
+    ASSERT_NE(first.find(key_dictionary().id("gene_name")), nullptr);
+    EXPECT_EQ(*first.find(key_dictionary().id("gene_name")), "Dnajc17");
+}
+
+TEST(GTF2BedTests, Arena_CopiesAndAlignsWithinChunks) {
+    Arena arena(64);
+    std::string_view a = arena.copy("hello");
+    uint64_t* numbers = arena.allocate_array<uint64_t>(3);
+    std::string_view big = arena.copy(std::string(200, 'x'));
+
+    EXPECT_EQ(a, "hello");
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(numbers) % alignof(uint64_t), 0u);
+    EXPECT_EQ(big.size(), 200u);
+    EXPECT_EQ(arena.chunks(), 2u);
+}
+
+
+TEST(GTF2BedTests, BedWriter_FormatsAndFlushesInBlocks) {
+    std::ostringstream out;
+    {
+        BedWriter bed(out, 8);
+        bed.append("chr1");
+        bed.append('\t');
+        bed.append(int64_t(-1));
+        bed.append_missing(2);
+        bed.end_row();
+        EXPECT_EQ(bed.size(), 0u); // a full block was handed to the stream
+        bed.append(int64_t(1234567890123));
+        bed.append_missing(100);
+        bed.end_row();
+    }
+    std::string expected = "chr1\t-1\t.\t.\n1234567890123";
+    for (int i = 0; i < 100; ++i) expected += "\t.";
+    expected += "\n";
+    EXPECT_EQ(out.str(), expected);
+
+    BedWriter buffer;
+    buffer.append("x");
+    buffer.end_row();
+    EXPECT_EQ(buffer.take(), "x\n");
+}
+
+TEST(GTF2BedTests, AnnotationStore_DictionaryEncodesColumns) {
+    AnnotationStore store;
+    GTFLine line;
+    line.seqname = "chr1";
+    line.feature = "exon";
+    line.start = 10;
+    line.end = 20;
+    line.attributes = {{"gene_id", "g1"}, {"exon_number", "1"}};
+    store.push_back(line);
+    line.start = 30;
+    line.attributes = {{"gene_id", "g1"}};
+    store.push_back(line);
+    line.seqname = "chr2";
+    line.feature = "gene";
+    store.push_back(line);
+
+    ASSERT_EQ(store.size(), 3u);
+    EXPECT_EQ(store.seqname_dictionary().size(), 2u);
+    EXPECT_EQ(store.feature_dictionary().size(), 2u);
+    EXPECT_EQ(store.starts(), (std::vector<int64_t>{10, 30, 30}));
+
+    uint32_t gene_id = key_dictionary().id("gene_id");
+    uint32_t exon_number = key_dictionary().id("exon_number");
+    EXPECT_EQ(*store.attribute(2, gene_id), "g1");
+    EXPECT_EQ(*store.attribute(0, exon_number), "1");
+    EXPECT_EQ(store.attribute(1, exon_number), nullptr);
+    // The run of equal gene_id values is stored once
+    EXPECT_EQ(store.column(gene_id)->values.size(), 2u);
+    EXPECT_EQ(store[2].seqname, "chr2");
+}
+
+
+// ---------- TESTS FOR .g2b SNAPSHOTS ---------- //
+
+// Converts example.gtf once from text and once through a snapshot, with the same selection
+static void expect_snapshot_matches_text(const std::unordered_set<std::string>& featureTypes,
+                                         const std::vector<std::string>& projection) {
+    const std::string input_file = "../data/example.gtf";
+    const std::string snapshot_file = "test_snapshot.g2b";
+
+    GTF2Bed text;
+    text.featureTypes = featureTypes;
+    text.attributeProjection = projection;
+    text.outFile = "test_output_text.bed";
+    text.cacheGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> textKeys = text.sortedAttributeKeys();
+    text.writeToBed(textKeys);
+
+    GTF2Bed builder;
+    builder.featureTypes = {"all"};
+    builder.buildSnapshot(input_file, FileFormat::GTF, snapshot_file);
+    ASSERT_TRUE(builder.snapshotIsFresh(snapshot_file, input_file, FileFormat::GTF));
+    EXPECT_FALSE(builder.snapshotIsFresh(snapshot_file, input_file, FileFormat::GFF3));
+
+    GTF2Bed mapped;
+    mapped.featureTypes = featureTypes;
+    mapped.attributeProjection = projection;
+    mapped.outFile = "test_output_snapshot.bed";
+    mapped.loadSnapshot(snapshot_file);
+    std::vector<std::string> mappedKeys = mapped.sortedAttributeKeys();
+    mapped.writeToBed(mappedKeys);
+
+    EXPECT_EQ(mapped.linecount, text.linecount);
+    EXPECT_EQ(mappedKeys, textKeys);
+    EXPECT_EQ(sha256_of_file(mapped.outFile), sha256_of_file(text.outFile));
+
+    std::remove(snapshot_file.c_str());
+    std::remove(text.outFile.c_str());
+    std::remove(mapped.outFile.c_str());
+}
+
+TEST(GTF2BedTest, SnapshotMatchesTextConversion) {
+    expect_snapshot_matches_text({"all"}, {});
+    expect_snapshot_matches_text({"exon", "CDS"}, {"gene_name", "exon_number"});
+    expect_snapshot_matches_text({"gene"}, {});
+}
+
+TEST(GTF2BedTest, SnapshotIsRebuiltWhenSourceChanges) {
+    vrb.set_silent();
+    const std::string input_file = "test_snapshot_source.gff3";
+    const std::string snapshot_file = "test_snapshot_source.g2b";
+    std::filesystem::copy_file("../data/test.gff3", input_file, std::filesystem::copy_options::overwrite_existing);
+
+    GTF2Bed converter;
+    EXPECT_FALSE(converter.snapshotIsFresh(snapshot_file, input_file, FileFormat::GFF3));
+    converter.buildSnapshot(input_file, FileFormat::GFF3, snapshot_file);
+    EXPECT_TRUE(converter.snapshotIsFresh(snapshot_file, input_file, FileFormat::GFF3));
+    {
+        AnnotationSnapshot snapshot(snapshot_file);
+        EXPECT_GT(snapshot.size(), 0u);
+        EXPECT_EQ(snapshot.format(), FileFormat::GFF3);
+    }
+
+    // Same size, different content and mtime
+    {
+        std::fstream edit(input_file, std::ios::in | std::ios::out | std::ios::binary);
+        edit.seekp(0);
+        edit.put('#');
+    }
+    std::filesystem::last_write_time(input_file, std::filesystem::last_write_time(input_file) + std::chrono::seconds(5));
+    EXPECT_FALSE(converter.snapshotIsFresh(snapshot_file, input_file, FileFormat::GFF3));
+
+    // A truncated snapshot is rejected, not read
+    converter.buildSnapshot(input_file, FileFormat::GFF3, snapshot_file);
+    std::filesystem::resize_file(snapshot_file, std::filesystem::file_size(snapshot_file) / 2);
+    EXPECT_THROW(AnnotationSnapshot truncated(snapshot_file), std::runtime_error);
+    EXPECT_FALSE(converter.snapshotIsFresh(snapshot_file, input_file, FileFormat::GFF3));
+
+    // So is one of the right size whose ids or codes point past their tables
+    converter.buildSnapshot(input_file, FileFormat::GFF3, snapshot_file);
+    g2b::Header header;
+    std::ifstream(snapshot_file, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+    g2b::AttributeEntry entry;
+    {
+        std::ifstream in(snapshot_file, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(header.attributes));
+        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+    }
+    const std::string intact = snapshot_file + ".intact";
+    std::filesystem::copy_file(snapshot_file, intact, std::filesystem::copy_options::overwrite_existing);
+    auto expect_corrupt = [&](uint64_t offset, uint32_t value) {
+        std::filesystem::copy_file(intact, snapshot_file, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream edit(snapshot_file, std::ios::in | std::ios::out | std::ios::binary);
+            edit.seekp(static_cast<std::streamoff>(offset));
+            edit.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        EXPECT_THROW(AnnotationSnapshot corrupt(snapshot_file), std::runtime_error);
+    };
+    expect_corrupt(header.columns[g2b::Seqname], header.dictionary_sizes[g2b::SeqnameDictionary]);
+    expect_corrupt(entry.codes, entry.value_count);
+    expect_corrupt(entry.values, static_cast<uint32_t>(header.string_count));
+    expect_corrupt(header.dictionaries, static_cast<uint32_t>(header.string_count));
+    expect_corrupt(header.string_offsets + sizeof(uint64_t), UINT32_MAX); // offsets[1] > offsets[2]
+    std::filesystem::copy_file(intact, snapshot_file, std::filesystem::copy_options::overwrite_existing);
+    EXPECT_NO_THROW(AnnotationSnapshot restored(snapshot_file));
+
+    std::remove(intact.c_str());
+    std::remove(input_file.c_str());
+    std::remove(snapshot_file.c_str());
+}
+
+
+// ---------- TESTS FOR --stats ---------- //
+
+TEST(GTF2BedTest, RunStatsCountLinesBytesAndPhases) {
+    GTF2Bed converter;
+    converter.featureTypes = {"gene"};
+    converter.outFile = "test_output_stats.bed";
+    converter.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+    std::vector<std::string> sortedKeys = converter.sortedAttributeKeys();
+    converter.writeToBed(sortedKeys);
+
+    const RunStats& stats = converter.stats;
+    EXPECT_EQ(stats.lines_kept, 298u);
+    EXPECT_GT(stats.lines_filtered, 0u);
+    EXPECT_EQ(stats.text_bytes_in, std::filesystem::file_size("../data/example.gtf"));
+    EXPECT_GT(stats.phases[RunStats::Parse].wall, 0.0);
+    EXPECT_GT(stats.phases[RunStats::Write].wall, 0.0);
+    for (const PhaseTime& phase : stats.phases) EXPECT_GE(phase.cpu, -1e-3);
+
+    std::ostringstream json;
+    stats.write_json(json);
+    EXPECT_NE(json.str().find("\"lines_kept\": 298"), std::string::npos);
+    EXPECT_NE(json.str().find("\"decompress\": {\"wall_seconds\""), std::string::npos);
+    EXPECT_NE(json.str().find("\"heap_allocations\": null"), std::string::npos);
+
+    std::remove(converter.outFile.c_str());
+}
+
+TEST(GTF2BedTest, RunStatsCountInputBytesOnceInTwoPasses) {
+    vrb.set_silent();
+    GTF2Bed streamed;
+    streamed.featureTypes = {"all"};
+    streamed.outFile = "test_output_stats_streamed.bed";
+    streamed.scanGTFFile("../data/example.gtf", FileFormat::GTF);
+    std::vector<std::string> sortedKeys = streamed.sortedAttributeKeys();
+    streamed.streamToBed("../data/example.gtf", FileFormat::GTF, sortedKeys);
+
+    GTF2Bed cached;
+    cached.featureTypes = {"all"};
+    cached.outFile = "test_output_stats_cached.bed";
+    cached.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+    sortedKeys = cached.sortedAttributeKeys();
+    cached.writeToBed(sortedKeys);
+
+    EXPECT_EQ(streamed.stats.text_bytes_in, std::filesystem::file_size("../data/example.gtf"));
+    EXPECT_EQ(streamed.stats.text_bytes_in, cached.stats.text_bytes_in);
+    std::remove(streamed.outFile.c_str());
+    std::remove(cached.outFile.c_str());
+}
+
+
+// ---------- TESTS FOR PROGRESS REPORTING ---------- //
+
+TEST(GTF2BedTests, ProgressReporter_PrintsPercentFromBackgroundThread) {
+    std::vector<std::string> messages;
+    std::atomic<uint64_t> position{0};
+    {
+        ProgressReporter progress("Read", 1000, [&position] { return position.load(); },
+                                  [&messages](const std::string& message) { messages.push_back(message); },
+                                  std::chrono::milliseconds(5));
+        for (int i = 0; i < 250; ++i) progress.line();
+        position = 250;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        // The loop itself never prints; messages are only appended by the reporter thread
+        progress.stop();
+        EXPECT_EQ(progress.lines(), 250u);
+    }
+    ASSERT_GE(messages.size(), 2u);
+    EXPECT_TRUE(std::any_of(messages.begin(), messages.end() - 1, [](const std::string& message) {
+        return message.find("Read 250 lines, 25% [ETA") != std::string::npos;
+    }));
+    EXPECT_EQ(messages.back().rfind("Read 250 lines in ", 0), 0u);
+}
+
+TEST(GTF2BedTests, ProgressReporter_SilentStartsNoThread) {
+    ProgressReporter progress("Read", 1000, nullptr, nullptr, std::chrono::milliseconds(1));
+    progress.add_lines(10);
+    progress.stop();
+    EXPECT_EQ(progress.lines(), 10u);
+}
+
+TEST(GTF2BedTest, GTFFileReportsCompressedBytesConsumed) {
+    std::string gzFile = "test_progress.gtf.gz";
+    {
+        std::ifstream plain("../data/example.gtf");
+        std::ofstream raw(gzFile, std::ios::binary);
+        boost::iostreams::filtering_ostream fdo;
+        fdo.push(boost::iostreams::gzip_compressor());
+        fdo.push(raw);
+        fdo << plain.rdbuf();
+    }
+    for (const std::string& file : {std::string("../data/example.gtf"), gzFile}) {
+        GTFFile gtf(file, FileFormat::GTF);
+        EXPECT_EQ(gtf.consumed_bytes(), 0u);
+        for (const GTFLineView& line : gtf) (void)line;
+        EXPECT_EQ(gtf.consumed_bytes(), std::filesystem::file_size(file));
+    }
+    std::remove(gzFile.c_str());
+}
+
+
+// ---------- TESTS FOR THE SYNTHETIC GENERATOR ---------- //
+
+static std::string synthetic(FileFormat format, uint64_t bytes, uint64_t seed) {
+    SyntheticOptions options;
+    options.format = format;
+    options.target_bytes = bytes;
+    options.seed = seed;
+    options.escape_percent = 5.0;
+    std::ostringstream out;
+    SyntheticAnnotation(options).write(out);
+    return std::move(out).str();
+}
+
+TEST(GTF2BedTests, SyntheticAnnotation_IsDeterministicAndParses) {
+    for (FileFormat format : {FileFormat::GTF, FileFormat::GFF, FileFormat::GFF3}) {
+        std::string text = synthetic(format, 200000, 7);
+        EXPECT_GE(text.size(), 200000u);
+        EXPECT_LT(text.size(), 400000u);
+        EXPECT_EQ(text, synthetic(format, 200000, 7));
+        EXPECT_NE(text, synthetic(format, 200000, 8));
+
+        std::istringstream in(text);
+        std::size_t lines = 0, with_gene_id = 0, decoded_notes = 0;
+        for (GTFIterator it(in, format), end; it != end; ++it) {
+            lines++;
+            for (const auto& attribute : it->attributes) {
+                if (attribute.key == "gene_id") with_gene_id++;
+                if (attribute.key == "Note" && attribute.value.find("protein, isoform") != std::string_view::npos) decoded_notes++;
+            }
+        }
+        EXPECT_GT(lines, 300u);
+        EXPECT_EQ(with_gene_id, lines);
+        EXPECT_GT(decoded_notes, 0u);
+    }
+}
+
+TEST(GTF2BedTest, SyntheticAnnotationConvertsTheSameOnAllPaths) {
+    std::string input_file = "test_synthetic.gff3";
+    {
+        SyntheticOptions options;
+        options.format = FileFormat::GFF3;
+        options.target_bytes = 2 << 20;
+        options.attributes = 20;
+        std::ofstream out(input_file, std::ios::binary);
+        SyntheticAnnotation(options).write(out);
+    }
+
+    GTF2Bed cached;
+    cached.featureTypes = {"all"};
+    cached.outFile = "test_output_synthetic_cached.bed";
+    cached.cacheGTFFile(input_file, FileFormat::GFF3);
+    std::vector<std::string> cachedKeys = cached.sortedAttributeKeys();
+    cached.writeToBed(cachedKeys);
+
+    GTF2Bed parallel;
+    parallel.featureTypes = {"all"};
+    parallel.threads = 4;
+    parallel.outFile = "test_output_synthetic_parallel.bed";
+    parallel.scanGTFFile(input_file, FileFormat::GFF3);
+    EXPECT_EQ(parallel.linecount, cached.linecount);
+    std::vector<std::string> parallelKeys = parallel.sortedAttributeKeys();
+    parallel.streamToBed(input_file, FileFormat::GFF3, parallelKeys);
+
+    EXPECT_EQ(cachedKeys, parallelKeys);
+    EXPECT_NE(std::find(cachedKeys.begin(), cachedKeys.end(), "attr_19"), cachedKeys.end());
+    EXPECT_EQ(sha256_of_file(cached.outFile), sha256_of_file(parallel.outFile));
+
+    std::remove(input_file.c_str());
+    std::remove(cached.outFile.c_str());
+    std::remove(parallel.outFile.c_str());
+}
+
+// ---------- TESTS FOR SORTED OUTPUT ---------- //
+
+// Rows of a BED file body, sorted the way `LC_ALL=C sort -s -k1,1 -k2,2n -k3,3n` does
+static std::vector<std::string> stable_sorted_rows(std::vector<std::string> rows) {
+    std::stable_sort(rows.begin(), rows.end(), [](const std::string& a, const std::string& b) {
+        return BedKey::of(a) < BedKey::of(b);
+    });
+    return rows;
+}
+
+static std::vector<std::string> read_lines(const std::string& filename) {
+    std::ifstream in(filename);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+TEST(GTF2BedTests, ParseSize_ReadsUnitsAndRejectsOverflow) {
+    EXPECT_EQ(parse_size("500000"), 500000u);
+    EXPECT_EQ(parse_size("64k"), 64u << 10);
+    EXPECT_EQ(parse_size("10MB"), 10u << 20);
+    EXPECT_EQ(parse_size("16G"), uint64_t(16) << 30);
+    EXPECT_EQ(parse_size("17179869183G"), uint64_t(17179869183) << 30);
+    EXPECT_EQ(parse_size("17179869184G"), 0u);
+    EXPECT_EQ(parse_size("18446744073709551615K"), 0u);
+    EXPECT_EQ(parse_size("99999999999999999999"), 0u);
+    EXPECT_EQ(parse_size("10T"), 0u);
+}
+
+TEST(GTF2BedTests, BedSorter_SpillsAndMergesStably) {
+    // Few chromosomes and positions, so many keys are equal; the last column is the input order
+    std::mt19937_64 rng(7);
+    std::vector<std::string> rows;
+    std::string text;
+    for (int i = 0; i < 200000; ++i) {
+        int64_t start = static_cast<int64_t>(rng() % 500);
+        rows.push_back("chr" + std::to_string(1 + rng() % 12) + "\t" + std::to_string(start) + "\t"
+                       + std::to_string(start + static_cast<int64_t>(rng() % 3)) + "\tgene\t" + std::to_string(i));
+        text += rows.back() + "\n";
+    }
+    const std::vector<std::string> expected = stable_sorted_rows(rows);
+
+    for (uint64_t budget : {uint64_t(1) << 30, uint64_t(1)}) {
+        BedSorter sorter(budget, 4, std::filesystem::temp_directory_path());
+        for (std::size_t pos = 0; pos < text.size(); pos += 1000) {
+            sorter.write(text.data() + pos, std::min<std::size_t>(1000, text.size() - pos)); // rows cut mid-line
+        }
+        std::ostringstream out;
+        sorter.finish(out);
+
+        std::vector<std::string> sorted;
+        std::istringstream in(out.str());
+        for (std::string line; std::getline(in, line);) sorted.push_back(line);
+        EXPECT_EQ(sorted, expected);
+        if (budget == 1) EXPECT_GT(sorter.runs(), BedSorter::max_fan_in); // takes an intermediate merge
+        else EXPECT_EQ(sorter.runs(), 0u);
+    }
+}
+
+TEST(GTF2BedTest, SortedOutputIsTheSameOnAllPaths) {
+    vrb.set_silent();
+    const std::string input_file = "../data/example.gtf";
+
+    GTF2Bed unsorted;
+    unsorted.featureTypes = {"all"};
+    unsorted.outFile = "test_output_unsorted.bed";
+    unsorted.cacheGTFFile(input_file, FileFormat::GTF);
+    std::vector<std::string> keys = unsorted.sortedAttributeKeys();
+    unsorted.writeToBed(keys);
+    std::vector<std::string> expected = read_lines(unsorted.outFile);
+    ASSERT_GT(expected.size(), 1u);
+    std::vector<std::string> body = stable_sorted_rows(std::vector<std::string>(expected.begin() + 1, expected.end()));
+    std::copy(body.begin(), body.end(), expected.begin() + 1);
+    ASSERT_NE(read_lines(unsorted.outFile), expected); // the example is not sorted already
+
+    auto sorted_converter = [](const std::string& outFile, uint64_t maxMemory, unsigned int threads) {
+        auto converter = std::make_unique<GTF2Bed>();
+        converter->featureTypes = {"all"};
+        converter->outFile = outFile;
+        converter->sortOutput = true;
+        converter->maxMemory = maxMemory;
+        converter->threads = threads;
+        converter->tempDir = std::filesystem::temp_directory_path().string();
+        return converter;
+    };
+
+    // In memory on the cached path
+    auto cached = sorted_converter("test_output_sorted_cached.bed", 1 << 30, 1);
+    cached->cacheGTFFile(input_file, FileFormat::GTF);
+    cached->writeToBed(keys);
+    EXPECT_EQ(read_lines(cached->outFile), expected);
+
+    // Streaming with a budget far below the input: sorted runs are spilled and merged
+    auto spilled = sorted_converter("test_output_sorted_spilled.bed", 1, 1);
+    spilled->scanGTFFile(input_file, FileFormat::GTF);
+    spilled->streamToBed(input_file, FileFormat::GTF, keys);
+    EXPECT_EQ(read_lines(spilled->outFile), expected);
+
+    // Parallel chunks feeding the sorter
+    auto parallel = sorted_converter("test_output_sorted_parallel.bed", 1 << 30, 4);
+    parallel->scanGTFFile(input_file, FileFormat::GTF);
+    parallel->streamToBed(input_file, FileFormat::GTF, keys);
+    EXPECT_EQ(read_lines(parallel->outFile), expected);
+
+    for (const std::string& file : {unsorted.outFile, cached->outFile, spilled->outFile, parallel->outFile}) {
+        std::remove(file.c_str());
+    }
+}
+
+// ---------- TESTS FOR TABIX/CSI INDEXING ---------- //
+
+static std::string inflate_bgzf_file(const std::string& filename) {
+    BGZFReader reader(filename, 1);
+    std::string inflated;
+    char buffer[10000];
+    std::streamsize n;
+    while ((n = reader.read(buffer, sizeof(buffer))) > 0) inflated.append(buffer, n);
+    return inflated;
+}
+
+// The line starting at a BGZF virtual offset
+static std::string line_at(const std::string& bgzFile, uint64_t voffset) {
+    std::ifstream raw(bgzFile, std::ios::binary);
+    raw.seekg(static_cast<std::streamoff>(voffset >> 16));
+    std::vector<unsigned char> block(bgzf::max_block_size);
+    raw.read(reinterpret_cast<char*>(block.data()), bgzf::header_size);
+    block.resize(bgzf::block_size(block.data(), bgzf::header_size));
+    raw.read(reinterpret_cast<char*>(block.data() + bgzf::header_size), static_cast<std::streamsize>(block.size() - bgzf::header_size));
+    std::string data = bgzf::inflate_block(block).substr(voffset & 0xffff);
+    return data.substr(0, data.find('\n'));
+}
+
+TEST(GTF2BedTest, IndexedOutputPointsAtEachChromosome) {
+    vrb.set_silent();
+    const std::string bgzFile = "test_output_indexed.bed.gz";
+
+    GTF2Bed converter;
+    converter.featureTypes = {"all"};
+    converter.outFile = bgzFile;
+    converter.sortOutput = true;
+    converter.indexOutput = true;
+    converter.maxMemory = 1 << 30;
+    converter.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+    std::vector<std::string> keys = converter.sortedAttributeKeys();
+    converter.writeToBed(keys);
+    converter.writeIndex();
+
+    // First row of every chromosome in the output
+    std::vector<std::pair<std::string, std::string>> firstRows;
+    std::istringstream bed(inflate_bgzf_file(bgzFile));
+    for (std::string line; std::getline(bed, line);) {
+        if (line[0] == '#') continue;
+        std::string chr = line.substr(0, line.find('\t'));
+        if (firstRows.empty() || firstRows.back().first != chr) firstRows.emplace_back(chr, line);
+    }
+
+    // Header, then per chromosome the pseudo-bin's first offset must land on its first row
+    std::string index = inflate_bgzf_file(bgzFile + ".tbi");
+    std::size_t p = 0;
+    auto i32 = [&] { uint32_t v; std::memcpy(&v, index.data() + p, 4); p += 4; return v; };
+    auto u64 = [&] { uint64_t v; std::memcpy(&v, index.data() + p, 8); p += 8; return v; };
+    ASSERT_EQ(index.substr(0, 4), std::string("TBI\1", 4));
+    p = 4;
+    ASSERT_EQ(i32(), firstRows.size());
+    EXPECT_EQ(i32(), 0x10000u);  // 0-based coordinates
+    EXPECT_EQ(i32(), 1u);
+    EXPECT_EQ(i32(), 2u);
+    EXPECT_EQ(i32(), 3u);
+    EXPECT_EQ(i32(), uint32_t('#'));
+    EXPECT_EQ(i32(), 0u);
+    uint32_t namesLength = i32();
+    std::string names = index.substr(p, namesLength);
+    p += namesLength;
+    for (const auto& [chr, first] : firstRows) {
+        EXPECT_EQ(names.substr(0, names.find('\0')), chr);
+        names.erase(0, names.find('\0') + 1);
+
+        uint32_t bins = i32();
+        bool sawMeta = false;
+        for (uint32_t b = 0; b < bins; ++b) {
+            uint32_t bin = i32();
+            uint32_t chunks = i32();
+            for (uint32_t c = 0; c < chunks; ++c) {
+                uint64_t begin = u64(), end = u64();
+                if (bin == 37450 && c == 0) {
+                    EXPECT_EQ(line_at(bgzFile, begin), first);
+                    EXPECT_LT(begin, end);
+                    sawMeta = true;
+                }
+            }
+        }
+        EXPECT_TRUE(sawMeta);
+        uint32_t windows = i32();
+        ASSERT_GT(windows, 0u);
+        uint64_t firstWindow = u64();
+        EXPECT_EQ(line_at(bgzFile, firstWindow), first);
+        p += 8 * (windows - 1);
+    }
+    EXPECT_EQ(u64(), 0u); // rows without coordinates
+    EXPECT_EQ(p, index.size());
+
+    std::remove(bgzFile.c_str());
+    std::remove((bgzFile + ".tbi").c_str());
+}
+
+TEST(GTF2BedTests, TabixIndex_SwitchesToCSIAndRejectsUnsortedRows) {
+    EXPECT_EQ(TabixIndex::region_bin(0, 1, 5), 4681u);
+    EXPECT_EQ(TabixIndex::region_bin(0, 1 << 29, 5), 0u);
+    EXPECT_EQ(TabixIndex::region_bin(16384, 16385, 5), 4682u);
+
+    std::ostringstream sink;
+    {
+        TabixIndex index;
+        index.attach(std::make_shared<BGZFWriter>(sink, 1));
+        const std::string rows = "#chr\tstart\tend\nchr1\t10\t20\nchr1\t15\t30\nchrBig\t100\t200\nchrBig\t600000000\t600000100\n";
+        index.add(rows.data(), 7); // pieces cut anywhere
+        index.add(rows.data() + 7, rows.size() - 7);
+        EXPECT_TRUE(index.sorted());
+        EXPECT_TRUE(index.csi());
+        EXPECT_EQ(index.references(), 2u);
+    }
+    {
+        TabixIndex index;
+        const std::string rows = "chr1\t10\t20\nchr2\t5\t6\nchr1\t30\t40\n";
+        index.add(rows.data(), rows.size());
+        EXPECT_FALSE(index.sorted());
+        EXPECT_NE(index.error().find("chr1"), std::string::npos);
+    }
+    {
+        TabixIndex index;
+        const std::string rows = "chr1\t10\t20\nchr1\t5\t6\n";
+        index.add(rows.data(), rows.size());
+        EXPECT_FALSE(index.sorted());
+        EXPECT_FALSE(index.csi());
+    }
+}
+
+// ---------- TESTS FOR REGION QUERIES ---------- //
+
+TEST(GTF2BedTests, RegionSet_ParsesAndMergesRegions) {
+    GenomicRegion region = GenomicRegion::parse("chr1:1,001-2,000");
+    EXPECT_EQ(region.chr, "chr1");
+    EXPECT_EQ(region.begin, 1000);
+    EXPECT_EQ(region.end, 2000);
+    region = GenomicRegion::parse("chr3:500");
+    EXPECT_EQ(region.begin, 499);
+    EXPECT_EQ(region.end, GenomicRegion::max_end);
+    EXPECT_EQ(GenomicRegion::parse("chrUn:KI270742v1").chr, "chrUn:KI270742v1");
+    EXPECT_THROW(GenomicRegion::parse("chr1:0-10"), std::invalid_argument);
+    EXPECT_THROW(GenomicRegion::parse("chr1:20-10"), std::invalid_argument);
+    EXPECT_THROW(GenomicRegion::parse(":1-2"), std::invalid_argument);
+    region = GenomicRegion::parse_bed("chr2\t10\t20\tname");
+    EXPECT_EQ(region.chr, "chr2");
+    EXPECT_EQ(region.begin, 10);
+    EXPECT_EQ(region.end, 20);
+    EXPECT_THROW(GenomicRegion::parse_bed("chr2\t10"), std::invalid_argument);
+
+    RegionSet regions;
+    regions.add("chr1", 300, 400);
+    regions.add("chr1", 100, 200);
+    regions.add("chr1", 150, 300); // joins both
+    regions.add("chr1", 500, 600);
+    ASSERT_EQ(*regions.find("chr1"), (RegionSet::Intervals{{100, 400}, {500, 600}}));
+    EXPECT_TRUE(regions.overlaps("chr1", 399, 450));
+    EXPECT_FALSE(regions.overlaps("chr1", 400, 500));
+    EXPECT_TRUE(regions.overlaps("chr1", 100, 100)); // empty feature at the start
+    EXPECT_FALSE(regions.overlaps("chr2", 100, 200));
+}
+
+// Sorted copy of the example on two sequences, as plain text and as bgzip with an
+// index in the layout of `tabix -p gff`. The second sequence is shifted by offset.
+static void write_indexed_gtf(const std::string& plainFile, const std::string& bgzFile, int64_t offset) {
+    std::vector<std::pair<int64_t, std::string>> rows;
+    for (const std::string& line : read_lines("../data/example.gtf")) {
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> fields;
+        boost::split(fields, line, boost::is_any_of("\t"));
+        rows.emplace_back(std::stoll(fields[3]), line);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::string text = "#!genome-build test\n";
+    for (const auto& row : rows) text += row.second + "\n";
+    for (const auto& row : rows) {
+        std::vector<std::string> fields;
+        boost::split(fields, row.second, boost::is_any_of("\t"));
+        fields[0] = "000001F";
+        fields[3] = std::to_string(std::stoll(fields[3]) + offset);
+        fields[4] = std::to_string(std::stoll(fields[4]) + offset);
+        text += boost::join(fields, "\t") + "\n";
+    }
+    std::ofstream(plainFile) << text;
+
+    std::ofstream out(bgzFile, std::ios::binary);
+    auto writer = std::make_shared<BGZFWriter>(out, 2);
+    TabixIndex index(TabixLayout::gff());
+    index.attach(writer);
+    for (std::size_t pos = 0; pos < text.size(); pos += 5000) writer->write(text.data() + pos, std::min<std::size_t>(5000, text.size() - pos));
+    writer->close();
+    out.close();
+    ASSERT_TRUE(index.sorted());
+    index.save(bgzFile);
+}
+
+TEST(GTF2BedTest, IndexedRegionQueryMatchesScan) {
+    vrb.set_silent();
+    const std::string plainFile = "test_regions.gtf";
+    const std::string bgzFile = "test_regions.gtf.gz";
+
+    // Tabix first, then CSI for a second sequence that lies beyond 2^29
+    for (int64_t offset : {int64_t(0), int64_t(600000000)}) {
+        write_indexed_gtf(plainFile, bgzFile, offset);
+        const std::string indexFile = TabixReader::find_for(bgzFile);
+        ASSERT_EQ(indexFile, bgzFile + (offset ? ".csi" : ".tbi"));
+
+        std::vector<std::string> regionTexts = {"000000F:1,000,000-3,000,000", "000000F:2500000-4000000", "000000F:20000000",
+                                                "000001F:" + std::to_string(offset + 5000001) + "-" + std::to_string(offset + 5500000),
+                                                "chrMissing"};
+        RegionSet regions;
+        for (const std::string& text : regionTexts) regions.add(GenomicRegion::parse(text));
+
+        auto convert = [&](const std::string& input, bool streaming, const std::string& outFile) {
+            GTF2Bed converter;
+            converter.featureTypes = {"all"};
+            converter.outFile = outFile;
+            converter.regions = regions;
+            converter.openInputIndex(input);
+            EXPECT_EQ(converter.inputIndex != nullptr, input == bgzFile);
+            if (streaming) {
+                converter.scanGTFFile(input, FileFormat::GTF);
+                std::vector<std::string> keys = converter.sortedAttributeKeys();
+                converter.streamToBed(input, FileFormat::GTF, keys);
+            } else {
+                converter.cacheGTFFile(input, FileFormat::GTF);
+                std::vector<std::string> keys = converter.sortedAttributeKeys();
+                converter.writeToBed(keys);
+            }
+            std::vector<std::string> lines = read_lines(outFile);
+            std::remove(outFile.c_str());
+            return lines;
+        };
+
+        // Lines a brute-force overlap test keeps
+        std::size_t expected = 0;
+        for (const std::string& line : read_lines(plainFile)) {
+            if (line[0] == '#') continue;
+            std::vector<std::string> fields;
+            boost::split(fields, line, boost::is_any_of("\t"));
+            expected += regions.overlaps(fields[0], std::stoll(fields[3]) - 1, std::stoll(fields[4]));
+        }
+        ASSERT_GT(expected, 100u);
+
+        const std::vector<std::string> scanned = convert(plainFile, false, "test_output_regions_scanned.bed");
+        EXPECT_EQ(scanned.size(), expected + 1);
+        EXPECT_EQ(convert(bgzFile, false, "test_output_regions_indexed.bed"), scanned);
+        EXPECT_EQ(convert(bgzFile, true, "test_output_regions_streamed.bed"), scanned);
+
+        // Only the blocks of the regions are read
+        TabixReader index(indexFile);
+        EXPECT_EQ(index.csi(), offset != 0);
+        EXPECT_EQ(index.names(), (std::vector<std::string>{"000000F", "000001F"}));
+        GTFFile gtf(bgzFile, FileFormat::GTF);
+        gtf.set_regions(&regions);
+        gtf.read_chunks(index.chunks(regions));
+        std::size_t lines = 0;
+        for (const GTFLineView& line : gtf) lines += !line.seqname.empty();
+        EXPECT_EQ(lines, expected);
+        EXPECT_LT(gtf.consumed_bytes() * 2, std::filesystem::file_size(bgzFile));
+
+        std::remove(indexFile.c_str());
+    }
+    std::remove(plainFile.c_str());
+    std::remove(bgzFile.c_str());
+}
+
+TEST(GTF2BedTest, SnapshotRegionQueryKeepsOnlyColumnsOfKeptRows) {
+    vrb.set_silent();
+    const std::string input = "test_snapshot_regions.gtf";
+    const std::string snapshotFile = "test_snapshot_regions.g2b";
+    std::ofstream(input) << "chr1\tsrc\tgene\t100\t200\t.\t+\t.\tgene_id \"g1\"; gene_name \"A\";\n"
+                         << "chr2\tsrc\tgene\t100\t200\t.\t+\t.\tgene_id \"g2\"; extra_key \"x\";\n";
+    RegionSet regions;
+    regions.add(GenomicRegion::parse("chr1"));
+
+    auto convert = [&](bool snapshot, const std::string& outFile) {
+        GTF2Bed converter;
+        converter.featureTypes = {"all"};
+        converter.outFile = outFile;
+        converter.regions = regions;
+        if (snapshot) {
+            if (!converter.snapshotIsFresh(snapshotFile, input, FileFormat::GTF)) converter.buildSnapshot(input, FileFormat::GTF, snapshotFile);
+            converter.loadSnapshot(snapshotFile);
+        } else {
+            converter.cacheGTFFile(input, FileFormat::GTF);
+        }
+        std::vector<std::string> keys = converter.sortedAttributeKeys();
+        converter.writeToBed(keys);
+        std::vector<std::string> lines = read_lines(outFile);
+        std::remove(outFile.c_str());
+        return lines;
+    };
+
+    const std::vector<std::string> scanned = convert(false, "test_output_snapshot_regions_text.bed");
+    ASSERT_EQ(scanned.size(), 2u);
+    EXPECT_EQ(scanned[0], "#chr\tstart\tend\tid\tinfo\tstrand\tgene_id\tgene_name");
+    EXPECT_EQ(convert(true, "test_output_snapshot_regions_built.bed"), scanned);  // builds the snapshot
+    EXPECT_EQ(convert(true, "test_output_snapshot_regions_mapped.bed"), scanned); // maps it
+    std::remove(input.c_str());
+    std::remove(snapshotFile.c_str());
+}
+
+// ---------- TESTS FOR POSITION ANNOTATION ---------- //
+
+TEST(GTF2BedTests, IntervalIndex_MatchesBruteForce) {
+    struct Raw {
+        std::string chr;
+        int64_t begin, end;
+    };
+    std::mt19937_64 rng(23);
+    std::vector<Raw> raw;
+    IntervalIndex index;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        const int64_t begin = static_cast<int64_t>(rng() % 100000);
+        const int64_t length = rng() % 10 == 0 ? 0 : static_cast<int64_t>(rng() % (rng() % 4 == 0 ? 20000 : 300));
+        raw.push_back({i % 3 ? "chr1" : "chr2", begin, begin + length});
+        index.add(raw.back().chr, begin, begin + length, i);
+    }
+    index.build();
+    EXPECT_EQ(index.size(), raw.size());
+
+    auto brute_overlaps = [&](const Raw& q) {
+        std::vector<uint32_t> values;
+        for (uint32_t i = 0; i < raw.size(); ++i) {
+            if (raw[i].chr == q.chr && raw[i].begin < std::max(q.end, q.begin + 1) && q.begin < std::max(raw[i].end, raw[i].begin + 1)) values.push_back(i);
+        }
+        return values;
+    };
+    auto distance_between = [](const Raw& q, const Raw& r) {
+        const int64_t r_end = std::max(r.end, r.begin + 1), q_end = std::max(q.end, q.begin + 1);
+        return r_end <= q.begin ? q.begin - r_end + 1 : q_end <= r.begin ? r.begin - q_end + 1 : 0;
+    };
+    auto brute_distance = [&](const Raw& q) {
+        int64_t best = -1;
+        for (const Raw& r : raw) {
+            if (r.chr == q.chr && (best < 0 || distance_between(q, r) < best)) best = distance_between(q, r);
+        }
+        return best;
+    };
+
+    std::vector<Raw> queries;
+    for (int i = 0; i < 600; ++i) {
+        const int64_t begin = static_cast<int64_t>(rng() % 110000);
+        queries.push_back({i % 5 == 0 ? "chr2" : (i % 7 == 0 ? "chrX" : "chr1"), begin, begin + static_cast<int64_t>(rng() % 500)});
+    }
+    auto sorted = [](std::vector<uint32_t> v) {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+
+    // Tree queries and nearest, in any order
+    for (const Raw& q : queries) {
+        ASSERT_EQ(sorted(index.overlaps(q.chr, q.begin, q.end)), brute_overlaps(q));
+        const auto closest = index.nearest(q.chr, q.begin, q.end);
+        const int64_t distance = brute_distance(q);
+        ASSERT_EQ(closest.has_value(), distance >= 0);
+        if (!closest) continue;
+        EXPECT_EQ(closest->distance, distance);
+        EXPECT_EQ(distance_between(q, raw[closest->value]), distance);
+    }
+
+    // A sweep gives the same hits for sorted and shuffled batches
+    for (bool shuffle : {false, true}) {
+        std::vector<Raw> batch = queries;
+        if (shuffle) std::shuffle(batch.begin(), batch.end(), rng);
+        else std::sort(batch.begin(), batch.end(), [](const Raw& a, const Raw& b) { return std::tie(a.chr, a.begin) < std::tie(b.chr, b.begin); });
+        IntervalIndex::Sweep sweep(index);
+        for (const Raw& q : batch) {
+            std::vector<uint32_t> values;
+            sweep.overlaps(q.chr, q.begin, q.end, [&values](const IntervalIndex::Interval& interval) { values.push_back(interval.value); });
+            ASSERT_EQ(sorted(values), brute_overlaps(q));
+        }
+    }
+}
+
+TEST(GTF2BedTest, AnnotatePositionsWritesOverlappingFeatures) {
+    vrb.set_silent();
+    std::vector<std::vector<std::string>> features;
+    for (const std::string& line : read_lines("../data/example.gtf")) {
+        if (line.empty() || line[0] == '#') continue;
+        features.emplace_back();
+        boost::split(features.back(), line, boost::is_any_of("\t"));
+    }
+    ASSERT_GT(features.size(), 100u);
+
+    // Starts of a few features, a position past the last one and one on a missing sequence
+    std::vector<GenomicRegion> positions;
+    for (std::size_t i = 0; i < features.size(); i += features.size() / 7) {
+        positions.push_back({features[i][0], std::stoll(features[i][3]) - 1, std::stoll(features[i][3])});
+    }
+    int64_t last_end = 0;
+    for (const auto& f : features) last_end = std::max<int64_t>(last_end, std::stoll(f[4]));
+    positions.push_back({features[0][0], last_end + 100, last_end + 101});
+    positions.push_back({"chrMissing", 10, 11});
+
+    std::ofstream bed("test_positions.bed");
+    std::ofstream vcf("test_positions.vcf");
+    vcf << "##fileformat=VCFv4.2\n#CHROM\tPOS\tID\tREF\tALT\n";
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        bed << positions[i].chr << "\t" << positions[i].begin << "\t" << positions[i].end << "\tq" << i << "\n";
+        vcf << positions[i].chr << "\t" << positions[i].end << "\tq" << i << "\tA\tG\n";
+    }
+    bed.close();
+    vcf.close();
+
+    auto annotate = [](const std::string& positionsFile, bool nearest) {
+        GTF2Bed converter;
+        converter.featureTypes = {"all"};
+        converter.outFile = "test_output_annotated.bed";
+        converter.cacheGTFFile("../data/example.gtf", FileFormat::GTF);
+        std::vector<std::string> keys = converter.sortedAttributeKeys();
+        converter.annotatePositions(positionsFile, keys, nearest);
+        std::vector<std::string> lines = read_lines(converter.outFile);
+        std::remove(converter.outFile.c_str());
+        return lines;
+    };
+
+    const std::vector<std::string> rows = annotate("test_positions.bed", false);
+    ASSERT_FALSE(rows.empty());
+    EXPECT_TRUE(boost::starts_with(rows[0], "#query_chr\tquery_start\tquery_end\tquery_name\tchr\tstart\tend\tid"));
+    std::size_t expected = 0;
+    for (const GenomicRegion& p : positions) {
+        std::size_t hits = 0;
+        for (const auto& f : features) hits += f[0] == p.chr && std::stoll(f[3]) - 1 < p.end && p.begin < std::stoll(f[4]);
+        expected += std::max<std::size_t>(hits, 1);
+    }
+    EXPECT_EQ(rows.size(), expected + 1);
+    EXPECT_TRUE(boost::starts_with(rows.back(), "chrMissing\t10\t11\tq" + std::to_string(positions.size() - 1) + "\t.\t.\t."));
+
+    // The VCF positions give the same rows
+    EXPECT_EQ(annotate("test_positions.vcf", false), rows);
+
+    // --nearest: the position past the end is reported with its distance
+    const std::vector<std::string> nearest = annotate("test_positions.bed", true);
+    EXPECT_EQ(nearest.size(), rows.size());
+    const std::string past = "q" + std::to_string(positions.size() - 2) + "\t";
+    auto row = std::find_if(nearest.begin(), nearest.end(), [&](const std::string& line) { return line.find(past) != std::string::npos; });
+    ASSERT_NE(row, nearest.end());
+    std::vector<std::string> fields;
+    boost::split(fields, *row, boost::is_any_of("\t"));
+    EXPECT_EQ(fields[4], "101");
+    EXPECT_EQ(fields[7], std::to_string(last_end));
+
+    std::remove("test_positions.bed");
+    std::remove("test_positions.vcf");
+}
+
+// ---------- TESTS FOR THE LIBRARY API ---------- //
+
+TEST(GTF2BedTest, LibraryConvertMatchesTool) {
+    vrb.set_silent();
+    const std::string input = "../data/example.gtf";
+    for (const std::vector<std::string>& featureTypes : {std::vector<std::string>{}, std::vector<std::string>{"exon", "gene"}}) {
+        for (const std::vector<std::string>& attributes : {std::vector<std::string>{}, std::vector<std::string>{"gene_name", "transcript_id"}}) {
+            GTF2Bed converter;
+            converter.featureTypes = featureTypes.empty() ? std::unordered_set<std::string>{"all"}
+                                                          : std::unordered_set<std::string>(featureTypes.begin(), featureTypes.end());
+            converter.attributeProjection = attributes;
+            converter.outFile = "test_output_tool.bed";
+            converter.cacheGTFFile(input, FileFormat::GTF);
+            std::vector<std::string> keys = converter.sortedAttributeKeys();
+            converter.writeToBed(keys);
+
+            gtf2bed::Options options;
+            options.feature_types = featureTypes;
+            options.attributes = attributes;
+            std::ostringstream out;
+            const gtf2bed::Summary summary = gtf2bed::convert(input, out, options);
+            std::ostringstream expected;
+            expected << std::ifstream(converter.outFile).rdbuf();
+            EXPECT_EQ(out.str(), expected.str());
+            EXPECT_EQ(summary.records, converter.linecount);
+            EXPECT_NE(std::find(summary.feature_types.begin(), summary.feature_types.end(), "transcript"), summary.feature_types.end());
+            std::remove(converter.outFile.c_str());
+        }
+    }
+}
+
+TEST(GTF2BedTest, LibraryReaderVisitsRecordsAndBatches) {
+    gtf2bed::Options options;
+    options.feature_types = {"exon"};
+    const gtf2bed::Reader reader("../data/example.gtf", options);
+
+    std::vector<std::string> records;
+    const gtf2bed::Summary summary = reader.read([&](const gtf2bed::Record& record) {
+        EXPECT_EQ(record.feature, "exon");
+        EXPECT_NE(record.find("gene_id"), nullptr);
+        records.push_back(std::string(record.seqname) + ":" + std::to_string(record.start) + "-" + std::to_string(record.end)
+                          + " " + std::string(*record.find("gene_id")));
+        return true;
+    });
+    ASSERT_GT(records.size(), 10u);
+    EXPECT_EQ(summary.records, records.size());
+    EXPECT_GT(summary.filtered, 0u);
+
+    // Batches own their text: kept past their callback and the pass, they still read the same
+    std::vector<gtf2bed::Batch> kept;
+    reader.read(7, [&](const gtf2bed::Batch& batch) {
+        EXPECT_LE(batch.size(), 7u);
+        kept.push_back(batch);
+        return true;
+    });
+    std::vector<std::string> batched;
+    for (const gtf2bed::Batch& batch : kept) {
+        for (const gtf2bed::Record& record : batch) {
+            batched.push_back(std::string(record.seqname) + ":" + std::to_string(record.start) + "-" + std::to_string(record.end)
+                              + " " + std::string(*record.find("gene_id")));
+        }
+    }
+    EXPECT_EQ(batched, records);
+    EXPECT_EQ(kept.size(), (records.size() + 6) / 7);
+
+    // Returning false stops the pass
+    std::size_t visited = 0;
+    EXPECT_EQ(reader.read([&](const gtf2bed::Record&) { return ++visited < 3; }).records, 3u);
+    EXPECT_EQ(visited, 3u);
+
+    // Errors are thrown, never reported through the tool's logger or exit()
+    EXPECT_THROW(gtf2bed::Reader("missing.gtf").read([](const gtf2bed::Record&) { return true; }), std::runtime_error);
+    gtf2bed::Options bad;
+    bad.regions = {"chr1:20-10"};
+    EXPECT_THROW(gtf2bed::Reader("../data/example.gtf", bad), std::invalid_argument);
+    gtf2bed::BedFormatter formatter({"gene_name"});
+    std::string row;
+    EXPECT_THROW(formatter.append(gtf2bed::Record{}, row), std::out_of_range);
+}
+
+// ---------- TESTS FOR BATCH CONVERSION ---------- //
+
+TEST(GTF2BedTest, BatchConversionMatchesSingleFiles) {
+    vrb.set_silent();
+    const std::string input = "../data/example.gtf";
+    std::filesystem::create_directories("test_batch");
+    std::filesystem::copy_file(input, "test_batch/plain.gtf", std::filesystem::copy_options::overwrite_existing);
+    {
+        std::ifstream in(input, std::ios::binary);
+        output_file out("test_batch/packed.gtf.gz");
+        out << in.rdbuf();
+    }
+    std::ofstream("test_batch/genes.gtf") << read_lines(input)[0] << "\n";
+    {
+        // An exon without gene_id fails the write after rows went out
+        std::ofstream out("test_batch/broken.gtf");
+        for (const std::string& line : read_lines(input)) out << line << "\n";
+        out << "000000F\tensembl\texon\t1\t10\t.\t+\t.\ttranscript_id \"x\";\n";
+    }
+
+    std::ofstream("test_batch/manifest.tsv") << "# input output format\n"
+                                             << "test_batch/plain.gtf\ttest_batch/out/plain.bed\tgtf\n"
+                                             << "test_batch/packed.gtf.gz test_batch/out/packed.bed\n"
+                                             << "test_batch/genes.gtf\ttest_batch/out/genes.bed\tGTF\n"
+                                             << "test_batch/broken.gtf\ttest_batch/out/broken.bed\n";
+    std::vector<BatchFile> files = readManifest("test_batch/manifest.tsv", "gtf");
+    ASSERT_EQ(files.size(), 4u);
+    EXPECT_EQ(files[1].output, "test_batch/out/packed.bed");
+    EXPECT_EQ(batch_output_name("dir/Mus_musculus.GRCm39.gtf.gz", false), "Mus_musculus.GRCm39.bed");
+    EXPECT_EQ(batch_output_name("x.gff3", true), "x.bed.gz");
+    std::filesystem::create_directories("test_batch/out");
+
+    // The plain file's cache (estimated at half its size) exceeds the budget: it is streamed
+    GTF2Bed settings;
+    settings.featureTypes = {"exon"};
+    settings.threads = 2;
+    settings.maxMemory = std::filesystem::file_size("test_batch/plain.gtf") / 2 - 1;
+    ASSERT_LT(std::filesystem::file_size("test_batch/packed.gtf.gz") * 5, settings.maxMemory);
+    convertBatch(settings, files, {});
+
+    GTF2Bed single;
+    single.featureTypes = {"exon"};
+    single.outFile = "test_output_batch_single.bed";
+    single.cacheGTFFile(input, FileFormat::GTF);
+    std::vector<std::string> keys = single.sortedAttributeKeys();
+    single.writeToBed(keys);
+    const std::vector<std::string> expected = read_lines(single.outFile);
+    std::remove(single.outFile.c_str());
+
+    EXPECT_EQ(read_lines("test_batch/out/plain.bed"), expected);
+    EXPECT_EQ(read_lines("test_batch/out/packed.bed"), expected);
+    EXPECT_TRUE(files[0].streamed);
+    EXPECT_EQ(files[0].mode, "streaming");
+    EXPECT_EQ(files[1].mode, "cached");
+    EXPECT_EQ(files[0].lines_kept, expected.size() - 1);
+    EXPECT_TRUE(files[0].error.empty());
+
+    // A file without exons fails on its own, and a failed write leaves no output
+    EXPECT_FALSE(files[2].error.empty());
+    EXPECT_TRUE(files[1].error.empty());
+    EXPECT_FALSE(files[3].error.empty());
+    EXPECT_FALSE(std::filesystem::exists("test_batch/out/broken.bed"));
+    EXPECT_EQ(files[3].bytes_out, 0u);
+
+    std::filesystem::remove_all("test_batch");
+}
+
+TEST(GTF2BedTest, BatchChargesUnwritableOutputToItsFile) {
+    vrb.set_silent();
+    std::filesystem::create_directories("test_batch_output/out");
+    std::ofstream("test_batch_output/afile") << "a regular file, not a directory\n";
+
+    // Plain and indexed output: the file that cannot be written fails alone, nothing exits
+    for (bool index : {false, true}) {
+        std::vector<BatchFile> files(2);
+        files[0].input = "../data/example.gtf";
+        files[0].output = "test_batch_output/out/s.bed.gz";
+        files[1].input = "../data/example.gtf";
+        files[1].output = "test_batch_output/afile/e.bed.gz";
+
+        GTF2Bed settings;
+        settings.featureTypes = {"all"};
+        settings.threads = 2;
+        settings.maxMemory = 1 << 30;
+        settings.tempDir = "test_batch_output";
+        settings.sortOutput = index;
+        settings.indexOutput = index;
+        convertBatch(settings, files, {});
+
+        EXPECT_TRUE(files[0].error.empty()) << files[0].error;
+        EXPECT_GT(files[0].bytes_out, 0u);
+        EXPECT_EQ(std::filesystem::exists("test_batch_output/out/s.bed.gz.tbi"), index);
+        EXPECT_NE(files[1].error.find("Cannot open output file [test_batch_output/afile/e.bed.gz]"), std::string::npos) << files[1].error;
+        std::filesystem::remove_all("test_batch_output/out");
+        std::filesystem::create_directories("test_batch_output/out");
+    }
+
+    std::filesystem::remove_all("test_batch_output");
+}
+
+TEST(GTF2BedTest, BatchChargesBadIndexToItsFile) {
+    vrb.set_silent();
+    std::filesystem::create_directories("test_batch_index/out");
+    write_indexed_gtf("test_batch_index/good.gtf", "test_batch_index/good.gtf.gz", 0);
+    write_indexed_gtf("test_batch_index/bad.gtf", "test_batch_index/bad.gtf.gz", 0);
+    std::ofstream("test_batch_index/bad.gtf.gz.tbi", std::ios::trunc) << "not an index";
+
+    std::vector<BatchFile> files(2);
+    files[0].input = "test_batch_index/good.gtf.gz";
+    files[0].output = "test_batch_index/out/good.bed";
+    files[1].input = "test_batch_index/bad.gtf.gz";
+    files[1].output = "test_batch_index/out/bad.bed";
+
+    GTF2Bed settings;
+    settings.featureTypes = {"all"};
+    settings.threads = 2;
+    settings.regions.add(GenomicRegion::parse("000000F:1000000-3000000"));
+    convertBatch(settings, files, {});
+
+    EXPECT_TRUE(files[0].error.empty());
+    EXPECT_GT(files[0].lines_kept, 0u);
+    EXPECT_FALSE(files[1].error.empty());
+    EXPECT_FALSE(std::filesystem::exists("test_batch_index/out/bad.bed"));
+
+    std::filesystem::remove_all("test_batch_index");
+}
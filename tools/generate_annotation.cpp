@@ -0,0 +1,73 @@
+#define _DECLARE_TOOLBOX_HERE
+#include "../lib/ntools.hpp"
+#include "../lib/SyntheticAnnotation.hpp"
+
+/**
+ * @brief Write a deterministic synthetic GTF/GFF/GFF3 file for scale testing
+ *
+ * The same options and seed always give byte-identical output. Output names
+ * ending in .gz/.bgz are written as BGZF, .bz2 with bzip2, and "-" is stdout.
+ */
+int main(int argc, char** argv)
+{
+    boost::program_options::options_description options_description("\x1B[35mSynthetic annotation\33[0m");
+    options_description.add_options()
+        ("help,h", "Produces option description")
+        ("output,o", boost::program_options::value<std::string>()->default_value("-"), "Output file (- for stdout)")
+        ("format,f", boost::program_options::value<std::string>()->default_value("gtf"), "file format [gtf/gff/gff3]")
+        ("size,s", boost::program_options::value<std::string>()->default_value("1M"), "Target size, e.g. 1M, 500M, 20G")
+        ("chromosomes", boost::program_options::value<unsigned int>()->default_value(22), "Number of chromosomes")
+        ("attributes", boost::program_options::value<unsigned int>()->default_value(8), "Distinct optional attribute keys besides the GENCODE core keys")
+        ("escape-percent", boost::program_options::value<double>()->default_value(1.0), "Percentage of GFF/GFF3 lines with a %-encoded value")
+        ("seed", boost::program_options::value<uint64_t>()->default_value(1), "Random seed")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(1), "Threads compressing .gz/.bgz output");
+
+    boost::program_options::variables_map options;
+    try {
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options_description), options);
+        boost::program_options::notify(options);
+    } catch (const boost::program_options::error& e) {
+        std::cerr << "Error parsing command line: " << e.what() << std::endl;
+        return 1;
+    }
+    if (options.count("help")) {
+        std::cout << options_description << std::endl;
+        return 0;
+    }
+
+    SyntheticOptions synthetic;
+    const std::string format = options["format"].as<std::string>();
+    if (format == "gtf") synthetic.format = FileFormat::GTF;
+    else if (format == "gff") synthetic.format = FileFormat::GFF;
+    else if (format == "gff3") synthetic.format = FileFormat::GFF3;
+    else {
+        std::cerr << "Unknown format [" << format << "]" << std::endl;
+        return 1;
+    }
+    synthetic.target_bytes = parse_size(options["size"].as<std::string>());
+    if (synthetic.target_bytes == 0) {
+        std::cerr << "Invalid size [" << options["size"].as<std::string>() << "]" << std::endl;
+        return 1;
+    }
+    synthetic.chromosomes = options["chromosomes"].as<unsigned int>();
+    synthetic.attributes = options["attributes"].as<unsigned int>();
+    synthetic.escape_percent = options["escape-percent"].as<double>();
+    synthetic.seed = options["seed"].as<uint64_t>();
+
+    SyntheticAnnotation generator(synthetic);
+    const std::string output = options["output"].as<std::string>();
+    uint64_t lines;
+    if (output == "-") {
+        lines = generator.write(std::cout);
+        std::cout.flush();
+    } else {
+        output_file fdo(output, std::max(1u, options["threads"].as<unsigned int>()));
+        if (fdo.fail()) {
+            std::cerr << "Cannot open output file [" << output << "]" << std::endl;
+            return 1;
+        }
+        lines = generator.write(fdo);
+    }
+    std::cerr << "Wrote " << lines << " lines (" << generator.bytes() << " bytes)" << std::endl;
+    return 0;
+}